@@ -0,0 +1,77 @@
+#include <SPI.h>
+#include <Wire.h>
+#include "SparkFun_AS3935.h"
+
+// 0x03 is default, but the address can also be 0x02, 0x01, or 0x00
+// Adjust the address jumpers on the underside of the product. 
+#define AS3935_ADDR 0x03 
+#define LIGHTNING_INT 0x08
+#define DISTURBER_INT 0x04
+#define NOISE_INT 0x01
+
+SparkFun_AS3935 lightning(AS3935_ADDR);
+
+// Events are captured into this queue as soon as they can be read, and printed
+// from it whenever the loop gets around to it. Eight records is plenty for an
+// Uno, bigger boards can afford more. 
+AS3935EventQueue<8> events; 
+
+// Interrupt pin for lightning detection, it must be interrupt capable. 
+const uint8_t lightningInt = 2; 
+uint8_t startup = 0; 
+
+// The interrupt service routine only timestamps the edge, the register read
+// happens later in poll(). 
+void lightningISR()
+{
+  lightning.notifyIrq(); 
+}
+
+void setup()
+{
+  // When lightning is detected the interrupt pin goes HIGH.
+  pinMode(lightningInt, INPUT); 
+
+  Serial.begin(115200); 
+  Serial.println("AS3935 Franklin Lightning Detector"); 
+  Wire.begin(); // Begin Wire before lightning sensor. 
+  startup = lightning.begin(); // Initialize the sensor. 
+  Serial.print("Did we start: "); 
+  if(!startup){
+    Serial.println ("No."); 
+    while(1); 
+  }
+  else
+    Serial.println("Schmow-ZoW (Yes)!");
+
+  attachInterrupt(digitalPinToInterrupt(lightningInt), lightningISR, RISING); 
+}
+
+void loop()
+{
+  // Returns right away if there is nothing to read yet. 
+  lightning.poll(events); 
+
+  AS3935EventRecord record; 
+  while(events.pop(record)){
+    Serial.print((unsigned long)record.timestamp); 
+    Serial.print(" ms: "); 
+    if(record.type == NOISE_INT)
+      Serial.println("Noise."); 
+    else if(record.type == DISTURBER_INT)
+      Serial.println("Disturber."); 
+    else if(record.type == LIGHTNING_INT){
+      Serial.print("Lightning Strike, approximately "); 
+      Serial.print((int)record.distance); 
+      Serial.print("km away, energy "); 
+      Serial.println((unsigned long)record.energy); 
+    }
+    if(record.late)
+      Serial.println("(read late, data may be stale)"); 
+  }
+
+  if(events.overflowCount()){
+    Serial.print("Events dropped: "); 
+    Serial.println((int)events.overflowCount()); 
+  }
+}
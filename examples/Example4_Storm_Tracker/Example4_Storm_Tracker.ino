@@ -0,0 +1,81 @@
+#include <SPI.h>
+#include <Wire.h>
+#include "SparkFun_AS3935.h"
+#include "SparkFun_AS3935_StormTracker.h"
+
+// 0x03 is default, but the address can also be 0x02, 0x01, or 0x00
+// Adjust the address jumpers on the underside of the product. 
+#define AS3935_ADDR 0x03 
+#define LIGHTNING_INT 0x08
+
+SparkFun_AS3935 lightning(AS3935_ADDR);
+
+// Keeps the last 15 minutes of strikes (6 periods of 2.5 minutes) in about
+// 160 bytes, no matter how busy the storm gets. 
+AS3935StormTracker<6> storm(150000UL); 
+
+// Interrupt pin for lightning detection, it must be interrupt capable. 
+const uint8_t lightningInt = 2; 
+uint8_t startup = 0; 
+unsigned long lastReport = 0; 
+
+void lightningISR()
+{
+  lightning.notifyIrq(); 
+}
+
+void setup()
+{
+  // When lightning is detected the interrupt pin goes HIGH.
+  pinMode(lightningInt, INPUT); 
+
+  Serial.begin(115200); 
+  Serial.println("AS3935 Franklin Lightning Detector"); 
+  Wire.begin(); // Begin Wire before lightning sensor. 
+  startup = lightning.begin(); // Initialize the sensor. 
+  Serial.print("Did we start: "); 
+  if(!startup){
+    Serial.println ("No."); 
+    while(1); 
+  }
+  else
+    Serial.println("Schmow-ZoW (Yes)!");
+
+  attachInterrupt(digitalPinToInterrupt(lightningInt), lightningISR, RISING); 
+}
+
+void loop()
+{
+  // Every strike goes into the tracker as soon as it is read. 
+  lightningEvent event; 
+  pollStatus status = lightning.poll(event); 
+  if( (status == POLL_EVENT) && (event.interrupt == LIGHTNING_INT) )
+    storm.add(event); 
+
+  // Once a minute, a summary of the storm. 
+  if(millis() - lastReport >= 60000UL){
+    lastReport = millis(); 
+    storm.update(lastReport); 
+    if(storm.strikes() == 0){
+      Serial.println("No lightning in the last 15 minutes."); 
+      return; 
+    }
+    Serial.print((unsigned long)storm.strikesPerHour()); 
+    Serial.print(" strikes per hour, closest "); 
+    Serial.print(storm.closestDistance()); 
+    Serial.print("km, mean "); 
+    Serial.print(storm.meanDistance()); 
+    Serial.print("km, median energy "); 
+    Serial.print((unsigned long)storm.energyPercentile(50)); 
+    Serial.print(". The storm is "); 
+    switch(storm.trendDirection()){
+      case TREND_APPROACHING: Serial.print("approaching"); break; 
+      case TREND_RECEDING:    Serial.print("moving away"); break; 
+      case TREND_STEADY:      Serial.print("holding its distance"); break; 
+      default:                Serial.print("too new to tell"); break; 
+    }
+    Serial.print(" ("); 
+    Serial.print(storm.trend()); 
+    Serial.println(" km/h)."); 
+  }
+}
@@ -0,0 +1,46 @@
+#include <SPI.h>
+#include <Wire.h>
+#include "SparkFun_AS3935.h"
+#include "SparkFun_AS3935_EventLog.h"
+
+// 0x03 is default, but the address can also be 0x02, 0x01, or 0x00
+// Adjust the address jumpers on the underside of the product. 
+#define AS3935_ADDR 0x03 
+
+SparkFun_AS3935 lightning(AS3935_ADDR);
+
+// Every event goes out over Serial as a binary record of 2 to 9 bytes instead
+// of a line of text. Capture the port to a file and read it on the computer
+// with extras/tools/as3935_log_tool: "decode" prints it, "replay" plays it
+// back through the driver. 
+AS3935LogEncoder logEncoder; 
+
+// Interrupt pin for lightning detection, it must be interrupt capable. 
+const uint8_t lightningInt = 2; 
+
+void lightningISR()
+{
+  lightning.notifyIrq(); 
+}
+
+void setup()
+{
+  // When lightning is detected the interrupt pin goes HIGH.
+  pinMode(lightningInt, INPUT); 
+
+  // Nothing but log records may be sent on this port. 
+  Serial.begin(115200); 
+  Wire.begin(); // Begin Wire before lightning sensor. 
+  if(!lightning.begin())
+    while(1); 
+
+  attachInterrupt(digitalPinToInterrupt(lightningInt), lightningISR, RISING); 
+}
+
+void loop()
+{
+  lightningEvent event; 
+  pollStatus status = lightning.poll(event); 
+  if( (status == POLL_EVENT) || (status == POLL_LATE_EVENT) )
+    logEncoder.write(Serial, event, 0, status == POLL_LATE_EVENT); 
+}
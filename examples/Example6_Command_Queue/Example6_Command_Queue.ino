@@ -0,0 +1,96 @@
+#include <SPI.h>
+#include <Wire.h>
+#include "SparkFun_AS3935.h"
+#include "SparkFun_AS3935_CommandQueue.h"
+
+// 0x03 is default, but the address can also be 0x02, 0x01, or 0x00
+// Adjust the address jumpers on the underside of the product. 
+#define AS3935_ADDR 0x03 
+#define LIGHTNING_INT 0x08
+
+SparkFun_AS3935 lightning(AS3935_ADDR);
+
+// Up to four register commands waiting at a time. Wire runs each transfer
+// to its end inside commands.service(). An unplugged sensor does not
+// acknowledge, so its commands end at once with a bus error. A bus held low
+// only times out where the core has setWireTimeout(), e.g. AVR: begin() sets
+// it to 10ms, change it with lightning.transport().setTransferTimeout()
+// before begin(). Elsewhere such a transfer can still hang the loop. 
+AS3935CommandQueue<4> commands(lightning); 
+
+// Interrupt pin for lightning detection, it must be interrupt capable. 
+const uint8_t lightningInt = 2; 
+uint8_t startup = 0; 
+uint8_t noiseFloor = 2; 
+unsigned long lastChange = 0; 
+
+void lightningISR()
+{
+  lightning.notifyIrq(); 
+}
+
+// Tells how each queued command went. 
+void commandDone(commandResult result, uint8_t reg, const uint8_t *data, uint8_t len, void *context)
+{
+  Serial.print((const char *)context); 
+  switch(result){
+    case COMMAND_OK:        Serial.print(" done, REG0x"); break; 
+    case COMMAND_BUS_ERROR: Serial.print(" not acknowledged, REG0x"); break; 
+    case COMMAND_TIMEOUT:   Serial.print(" timed out, REG0x"); break; 
+    default:                Serial.print(" cancelled, REG0x"); break; 
+  }
+  Serial.print(reg, HEX); 
+  for(uint8_t i = 0; i < len; i++){
+    Serial.print(" "); 
+    Serial.print(data[i], HEX); 
+  }
+  Serial.println(); 
+}
+
+void setup()
+{
+  // When lightning is detected the interrupt pin goes HIGH.
+  pinMode(lightningInt, INPUT); 
+
+  Serial.begin(115200); 
+  Serial.println("AS3935 Franklin Lightning Detector"); 
+  Wire.begin(); // Begin Wire before lightning sensor. 
+  startup = lightning.begin(); // Initialize the sensor. 
+  Serial.print("Did we start: "); 
+  if(!startup){
+    Serial.println ("No."); 
+    while(1); 
+  }
+  else
+    Serial.println("Schmow-ZoW (Yes)!");
+
+  // The whole configuration in the background: one read and at most two
+  // writes, each started by a later commands.service(). 
+  AS3935Config config; 
+  config.indoorOutdoor = INDOOR; 
+  config.maskDisturber = true; 
+  commands.applyConfig(config, commandDone, (void *)"Configuration"); 
+
+  attachInterrupt(digitalPinToInterrupt(lightningInt), lightningISR, RISING); 
+}
+
+void loop()
+{
+  // Runs at most one transfer, call it every time around. 
+  commands.service(); 
+
+  // Every ten seconds, step the noise floor and read it back. 
+  if( (millis() - lastChange >= 10000UL) && (commands.pending() == 0) ){
+    lastChange = millis(); 
+    noiseFloor = (noiseFloor % 7) + 1; 
+    commands.writeField<AS3935_NF_LEV>(noiseFloor, commandDone, (void *)"Noise floor"); 
+    commands.read(THRESHOLD, 1, commandDone, (void *)"Threshold register"); 
+  }
+
+  lightningEvent event; 
+  if( (lightning.poll(event) == POLL_EVENT) && (event.interrupt == LIGHTNING_INT) ){
+    Serial.print("Lightning, "); 
+    Serial.print(event.distance); 
+    Serial.println("km away."); 
+  }
+}
@@ -0,0 +1,197 @@
+/*
+  Bus cost of the AS3935 driver, measured against the register emulator.
+
+  For every public call and for a full event handling cycle this prints the
+  number of bus transactions, the bus setups (SPI transactions or I2C STARTs
+  after a STOP), the bytes on the wire, the simulated bus time and the total
+  time the call took including its internal delays. It runs
+  once over I2C at 400kHz and once over SPI at 2MHz, with and without the
+  shadow register cache. Build with the CMake target as3935_benchmark, and
+  configure with -DAS3935_INSTRUMENTATION=ON to also print the driver's own
+  counters. 
+*/
+
+#include <stdio.h>
+#include "SparkFun_AS3935_Emulator.h"
+
+// One measurement, the difference between two snapshots. 
+struct Sample {
+  uint32_t transactions; 
+  uint32_t setups; 
+  uint32_t wireBytes; 
+  uint32_t busMicros; 
+  uint32_t elapsedMicros; 
+};
+
+class Bench
+{
+  public:
+    Bench(uint32_t _busHz, bool _spi, bool _shadow) :
+      _driver(AS3935EmulatorTransport(&_emulator, _busHz, _spi)), _useShadow(_shadow) { }
+
+    SparkFun_AS3935_Emulated &driver() { return _driver; }
+    AS3935Emulator &emulator() { return _emulator; }
+    bool shadow() const { return _useShadow; }
+
+    void start()
+    {
+      _before = _driver.transport().counters(); 
+      _startMicros = _emulator.nowMicros(); 
+    }
+
+    Sample stop()
+    {
+      const as3935BusCounters &_after = _driver.transport().counters(); 
+      Sample _s; 
+      _s.transactions = (_after.reads + _after.writes + _after.probes) - (_before.reads + _before.writes + _before.probes); 
+      _s.setups = _after.setups - _before.setups; 
+      _s.wireBytes = _after.wireBytes - _before.wireBytes; 
+      _s.busMicros = _after.busMicros - _before.busMicros; 
+      _s.elapsedMicros = _emulator.nowMicros() - _startMicros; 
+      return _s; 
+    }
+
+  private:
+    AS3935Emulator _emulator; 
+    SparkFun_AS3935_Emulated _driver; 
+    bool _useShadow; 
+    as3935BusCounters _before; 
+    uint32_t _startMicros; 
+};
+
+static void report(const char *_name, const Sample &_s)
+{
+  printf("  %-44s %5lu %6lu %6lu %8lu %9lu\n", _name, (unsigned long)_s.transactions, (unsigned long)_s.setups,
+    (unsigned long)_s.wireBytes,
+    (unsigned long)_s.busMicros, (unsigned long)_s.elapsedMicros); 
+}
+
+// Expands to: start, run the statement, report it under its own text. 
+#define MEASURE(bench, statement) do { (bench).start(); statement; report(#statement, (bench).stop()); } while(0)
+
+// A burst of driver calls, as after a configuration change. 
+static void reconfigure(SparkFun_AS3935_Emulated &lightning)
+{
+  lightning.setIndoorOutdoor(INDOOR); 
+  lightning.setNoiseLevel(2); 
+  lightning.watchdogThreshold(2); 
+  lightning.spikeRejection(2); 
+  lightning.maskDisturber(true); 
+  lightning.tuneCap(3); 
+  lightning.lightningEnergy(); 
+  lightning.distanceToStorm(); 
+}
+
+static void runSuite(const char *_title, uint32_t _busHz, bool _spi, bool _shadow)
+{
+  Bench b(_busHz, _spi, _shadow); 
+  SparkFun_AS3935_Emulated &lightning = b.driver(); 
+  AS3935Emulator &emu = b.emulator(); 
+
+  printf("\n%s, shadow cache %s\n", _title, _shadow ? "on" : "off"); 
+  printf("  %-44s %5s %6s %6s %8s %9s\n", "call", "xfers", "setups", "bytes", "bus us", "total us"); 
+
+  lightning.useShadowRegisters(_shadow); 
+  MEASURE(b, lightning.begin()); 
+  emu.injectLightning(0x51234, 14); 
+  emu.advanceMillis(3); 
+  MEASURE(b, lightning.lightningEnergy()); 
+  MEASURE(b, lightning.distanceToStorm()); 
+  MEASURE(b, lightning.setNoiseLevel(3)); 
+  MEASURE(b, lightning.watchdogThreshold(3)); 
+  MEASURE(b, lightning.spikeRejection(3)); 
+  MEASURE(b, lightning.maskDisturber(true)); 
+  MEASURE(b, lightning.tuneCap(5)); 
+  MEASURE(b, lightning.clearStatistics(true)); 
+  MEASURE(b, lightning.readNoiseLevel()); 
+
+  AS3935Config config; 
+  config.indoorOutdoor = OUTDOOR; 
+  config.noiseLevel = 4; 
+  config.watchdog = 4; 
+  config.spike = 4; 
+  config.maskDisturber = false; 
+  config.tuneCap = 7; 
+  MEASURE(b, lightning.applyConfig(config)); 
+
+  // Recovering from a reset: every setter again, or the saved state. 
+  as3935State _state; 
+  MEASURE(b, lightning.saveState(_state)); 
+  lightning.resetSettings(); 
+  b.start(); 
+  lightning.setIndoorOutdoor(OUTDOOR); 
+  lightning.setNoiseLevel(4); 
+  lightning.watchdogThreshold(4); 
+  lightning.spikeRejection(4); 
+  lightning.maskDisturber(false); 
+  lightning.tuneCap(7); 
+  report("six setters after resetSettings()", b.stop()); 
+  lightning.resetSettings(); 
+  MEASURE(b, lightning.restoreState(_state)); 
+
+  // Setters and event reads, one bus setup each or one session for all. 
+  emu.injectLightning(0x01234, 10); 
+  b.start(); 
+  reconfigure(lightning); 
+  report("six setters + energy + distance", b.stop()); 
+  emu.injectLightning(0x01234, 10); 
+  b.start(); 
+  {
+    AS3935BusSession<SparkFun_AS3935_Emulated> _session(lightning); 
+    reconfigure(lightning); 
+  }
+  report("the same in one AS3935BusSession", b.stop()); 
+
+  MEASURE(b, lightning.powerDown()); 
+  MEASURE(b, lightning.wakeUp()); 
+  MEASURE(b, lightning.resetSettings()); 
+
+  // A full event: what the examples do, then the same event through the
+  // burst read and through the non-blocking path. 
+  printf("  -- event handling cycle --\n"); 
+  emu.injectLightning(0x01234, 10); 
+  b.start(); 
+  uint8_t _int = lightning.readInterruptReg(); 
+  if(_int == LIGHTNING){
+    lightning.distanceToStorm(); 
+    lightning.lightningEnergy(); 
+  }
+  report("readInterruptReg + distance + energy", b.stop()); 
+
+  lightningEvent _event; 
+  emu.injectLightning(0x01234, 10); 
+  MEASURE(b, lightning.readEventSnapshot(_event)); 
+
+  emu.injectLightning(0x01234, 10); 
+  lightning.notifyIrq(); 
+  emu.advanceMicros(IRQ_SETTLE_US); 
+  MEASURE(b, lightning.poll(_event)); 
+
+  tuneResult _tune; 
+  b.start(); 
+  lightning.autoTuneAntenna(AS3935Emulator::countPulses, &emu, _tune); 
+  report("lightning.autoTuneAntenna(countPulses, ...)", b.stop()); 
+
+#ifdef AS3935_INSTRUMENTATION
+  // What the driver counted itself over the whole suite. 
+  instrumentationSnapshot _stats; 
+  lightning.readInstrumentation(_stats); 
+  printf("  -- driver instrumentation --\n"); 
+  printf("  reads %lu (%lu bytes, %lu errors), writes %lu (%lu bytes, %lu errors)\n",
+    (unsigned long)_stats.reads, (unsigned long)_stats.bytesRead, (unsigned long)_stats.readErrors,
+    (unsigned long)_stats.writes, (unsigned long)_stats.bytesWritten, (unsigned long)_stats.writeErrors); 
+  printf("  bus %lu us, blocked %lu us, %lu polled events, max latency %lu us\n",
+    (unsigned long)_stats.busMicros, (unsigned long)_stats.blockedMicros,
+    (unsigned long)_stats.events, (unsigned long)_stats.maxLatencyMicros); 
+#endif
+}
+
+int main()
+{
+  printf("AS3935 driver bus cost against the register emulator\n"); 
+  runSuite("I2C 400kHz", 400000, false, false); 
+  runSuite("I2C 400kHz", 400000, false, true); 
+  runSuite("SPI 2MHz", 2000000, true, false); 
+  runSuite("SPI 2MHz", 2000000, true, true); 
+  return 0; 
+}
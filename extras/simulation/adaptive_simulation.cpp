@@ -0,0 +1,115 @@
+/*
+  AS3935AdaptiveController against a simulated site.
+
+  Forty minutes of weather are played into the register emulator twice,
+  once with the baseline settings left alone and once with the controller:
+  a distant storm throughout, a disturber storm from minute 5 to 15 and
+  broadband noise from minute 20 to 25. Every five minutes it prints the
+  interrupts the MCU had to read, the bus writes made for configuration
+  and how many of the strikes sent were reported. Build with the CMake
+  target as3935_adaptive_simulation.
+*/
+
+#include <stdio.h>
+#include "SparkFun_AS3935_Emulator.h"
+#include "SparkFun_AS3935_Adaptive.h"
+
+#define TICK_MS        100
+#define MINUTES        40
+#define PERIOD_MINUTES 5
+
+typedef AS3935AdaptiveController<SparkFun_AS3935_Emulated> adaptiveEmulated; 
+
+// Small deterministic generator so that both runs see the same weather.
+static uint32_t _seed; 
+static uint32_t nextRandom(uint32_t _range)
+{
+  _seed = _seed * 1664525UL + 1013904223UL; 
+  return (_seed >> 8) % _range; 
+}
+
+struct Period {
+  uint32_t interrupts; 
+  uint32_t strikesSent; 
+  uint32_t strikesSeen; 
+  uint32_t configWrites; 
+};
+
+static void run(bool _adaptive)
+{
+  AS3935Emulator emu; 
+  SparkFun_AS3935_Emulated lightning(AS3935EmulatorTransport(&emu, 400000, false)); 
+  lightning.useShadowRegisters(true); 
+  lightning.begin(); 
+  AS3935Config baseline; 
+  lightning.applyConfig(baseline); 
+  adaptiveEmulated controller(lightning); 
+  if(_adaptive)
+    controller.begin(baseline); 
+
+  _seed = 12345; 
+  Period period; 
+  memset(&period, 0, sizeof(period)); 
+  uint32_t writesBefore = lightning.transport().counters().writes; 
+  uint32_t totalIrq = 0, totalSent = 0, totalSeen = 0; 
+
+  printf("\n%s\n", _adaptive ? "With the adaptive controller" : "Baseline settings only"); 
+  printf("  minutes  interrupts  config writes  strikes seen/sent  noise step  disturber step\n"); 
+
+  for(uint32_t _tick = 0; _tick < (MINUTES * 60000UL / TICK_MS); _tick++){
+    uint32_t _minute = _tick * TICK_MS / 60000UL; 
+
+    // Weather for this tick. A strike about every 20s of random strength.
+    if(nextRandom(200) == 0){
+      emu.injectLightning(0x2000 + nextRandom(0x4000), 20 + nextRandom(20), 3 + nextRandom(13)); 
+      period.strikesSent++; 
+    }
+    if( (_minute >= 5) && (_minute < 15) && (nextRandom(10) < 3) )
+      emu.injectDisturber(nextRandom(12)); 
+    if( (_minute >= 20) && (_minute < 25) && (nextRandom(10) == 0) )
+      emu.injectNoise(2 + nextRandom(4)); 
+
+    // The IRQ pin and what the loop does about it.
+    if(emu.irqLine()){
+      lightning.notifyIrq(); 
+      emu.advanceMicros(IRQ_SETTLE_US); 
+      lightningEvent _event; 
+      pollStatus _status = lightning.poll(_event); 
+      if( (_status == POLL_EVENT) || (_status == POLL_LATE_EVENT) ){
+        period.interrupts++; 
+        if(_event.interrupt == LIGHTNING)
+          period.strikesSeen++; 
+        if(_adaptive)
+          controller.record(_event.interrupt); 
+      }
+    }
+    if(_adaptive)
+      controller.service(); 
+    emu.advanceMicros(TICK_MS * 1000UL - IRQ_SETTLE_US); 
+
+    if( ((_tick + 1) % (PERIOD_MINUTES * 60000UL / TICK_MS)) == 0 ){
+      uint32_t _writes = lightning.transport().counters().writes; 
+      period.configWrites = _writes - writesBefore; 
+      writesBefore = _writes; 
+      printf("  %2lu - %2lu  %10lu  %13lu  %8lu/%-8lu  %10u  %14u\n",
+        (unsigned long)(_minute + 1 - PERIOD_MINUTES), (unsigned long)(_minute + 1),
+        (unsigned long)period.interrupts, (unsigned long)period.configWrites,
+        (unsigned long)period.strikesSeen, (unsigned long)period.strikesSent,
+        controller.noiseStep(), controller.disturberStep()); 
+      totalIrq += period.interrupts; 
+      totalSent += period.strikesSent; 
+      totalSeen += period.strikesSeen; 
+      memset(&period, 0, sizeof(period)); 
+    }
+  }
+  printf("  total    %10lu  %13s  %8lu/%-8lu  %lu adjustments\n", (unsigned long)totalIrq, "",
+    (unsigned long)totalSeen, (unsigned long)totalSent, (unsigned long)controller.adjustments()); 
+}
+
+int main()
+{
+  printf("Adaptive noise floor and disturber control, %d minutes simulated\n", MINUTES); 
+  run(false); 
+  run(true); 
+  return 0; 
+}
@@ -0,0 +1,126 @@
+/*
+  AS3935CommandQueue against a misbehaving bus.
+
+  The register emulator's transport is switched to non-blocking transfers
+  that finish 300us after they start, and a control loop that does 50us of
+  other work per pass services the queue. Four runs: a healthy bus, two
+  transfers that are not acknowledged, a bus stalled for 15ms, and a
+  detector that is gone. Each run prints every command's result, how long
+  the longest service() call took, how many loop passes went by meanwhile,
+  and whether the IC ended up configured as asked. For comparison it also
+  times the blocking applyConfig(). Build with the CMake target
+  as3935_command_queue_simulation.
+*/
+
+#include <stdio.h>
+#include "SparkFun_AS3935_Emulator.h"
+#include "SparkFun_AS3935_CommandQueue.h"
+
+#define LOOP_WORK_US    50
+#define DEVICE_LATENCY_US 300
+
+typedef AS3935CommandQueue<8, SparkFun_AS3935_Emulated> commandQueueEmulated; 
+
+static const char *resultName(commandResult _result)
+{
+  switch(_result){
+    case COMMAND_OK:        return "ok"; 
+    case COMMAND_BUS_ERROR: return "bus error"; 
+    case COMMAND_TIMEOUT:   return "timeout"; 
+    default:                return "cancelled"; 
+  }
+}
+
+struct Run {
+  AS3935Emulator *emu; 
+  uint32_t startMicros; 
+  uint8_t done; 
+};
+
+static void onCommand(commandResult _result, uint8_t _reg, const uint8_t *_data, uint8_t _len, void *_context)
+{
+  Run *_run = (Run *)_context; 
+  printf("    %6lu us  REG0x%02X x%u  %-9s ", (unsigned long)(_run->emu->nowMicros() - _run->startMicros),
+    _reg, _len, resultName(_result)); 
+  for(uint8_t i = 0; i < _len; i++)
+    printf(" %02X", _data[i]); 
+  printf("\n"); 
+  _run->done++; 
+}
+
+// Queues a configuration, one field and a full read, then runs the loop
+// until the queue is empty. _fault is applied right before.
+static void run(const char *_title, void (*_fault)(AS3935Emulator &, AS3935EmulatorTransport &))
+{
+  AS3935Emulator emu; 
+  SparkFun_AS3935_Emulated lightning(AS3935EmulatorTransport(&emu, 400000, false)); 
+  lightning.useShadowRegisters(true); 
+  lightning.begin(); 
+  lightning.transport().setLatency(DEVICE_LATENCY_US); 
+  commandQueueEmulated queue(lightning); 
+
+  AS3935Config config; 
+  config.indoorOutdoor = OUTDOOR; 
+  config.noiseLevel = 4; 
+  config.spike = 5; 
+  config.tuneCap = 9; 
+
+  printf("\n%s\n", _title); 
+  Run _run = { &emu, emu.nowMicros(), 0 };
+  queue.applyConfig(config, onCommand, &_run); 
+  queue.writeField<AS3935_MASK_DIST>(1, onCommand, &_run); 
+  queue.read(AFE_GAIN, 9, onCommand, &_run); 
+  if(_fault)
+    _fault(emu, lightning.transport()); 
+
+  uint32_t _passes = 0, _longest = 0; 
+  while(queue.pending()){
+    uint32_t _before = emu.nowMicros(); 
+    queue.service(); 
+    uint32_t _took = emu.nowMicros() - _before; 
+    if(_took > _longest)
+      _longest = _took; 
+    emu.advanceMicros(LOOP_WORK_US); // The rest of the loop.
+    _passes++; 
+    if( (emu.nowMicros() - _run.startMicros) >= 15000UL )
+      lightning.transport().stallBus(false); // A stalled bus lets go after 15ms.
+  }
+  lightning.transport().stallBus(false); 
+  emu.setPresent(true); 
+
+  AS3935Config _read; 
+  lightning.readConfig(_read); 
+  bool _configured = (_read.indoorOutdoor == OUTDOOR) && (_read.noiseLevel == 4) &&
+    (_read.spike == 5) && (_read.tuneCap == 9) && _read.maskDisturber; 
+  printf("  %u commands in %lu loop passes, longest service() %lu us, %lu bus errors, %lu timeouts, IC %s\n",
+    _run.done, (unsigned long)_passes, (unsigned long)_longest, (unsigned long)queue.busErrors(),
+    (unsigned long)queue.timeouts(), _configured ? "configured" : "not configured"); 
+}
+
+static void healthy(AS3935Emulator &, AS3935EmulatorTransport &) { }
+static void nacks(AS3935Emulator &, AS3935EmulatorTransport &_bus) { _bus.failTransfers(2); }
+static void stalled(AS3935Emulator &, AS3935EmulatorTransport &_bus) { _bus.stallBus(true); }
+static void absent(AS3935Emulator &_emu, AS3935EmulatorTransport &) { _emu.setPresent(false); }
+
+int main()
+{
+  printf("AS3935CommandQueue, I2C 400kHz, %dus device latency, %dus of other work per loop pass\n",
+    DEVICE_LATENCY_US, LOOP_WORK_US); 
+
+  // The same configuration through the blocking call.
+  AS3935Emulator emu; 
+  SparkFun_AS3935_Emulated lightning(AS3935EmulatorTransport(&emu, 400000, false)); 
+  lightning.begin(); 
+  AS3935Config config; 
+  config.indoorOutdoor = OUTDOOR; 
+  config.noiseLevel = 4; 
+  uint32_t _before = emu.nowMicros(); 
+  lightning.applyConfig(config); 
+  printf("blocking applyConfig(): %lu us without returning to the loop\n", (unsigned long)(emu.nowMicros() - _before)); 
+
+  run("Healthy bus", healthy); 
+  run("Next two transfers not acknowledged", nacks); 
+  run("Bus stalled for 15ms", stalled); 
+  run("Detector gone", absent); 
+  return 0; 
+}
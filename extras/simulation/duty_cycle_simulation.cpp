@@ -0,0 +1,113 @@
+/*
+  AS3935DutyCycle against a simulated day on a battery node.
+
+  Three hours are played into the register emulator: one minute of listening
+  every five, a trigger from another node at minute 47 and a storm from
+  minute 90 to 120 with a strike every 30 seconds. The emulator, like the
+  datasheet, loses the RC oscillator calibration on power down, so every
+  wake up here calibrates. It prints the share of time the detector was
+  powered, the wake ups and failed ones, the wake latency and the strikes
+  reported. Then the microcontroller restarts while the AS3935 keeps
+  listening, where startWakeUp(false) skips the calibration, and the same
+  call after powerDown(), where it may not. Build with the CMake target
+  as3935_duty_cycle_simulation.
+*/
+
+#include <stdio.h>
+#include "SparkFun_AS3935_Emulator.h"
+#include "SparkFun_AS3935_DutyCycle.h"
+
+#define TICK_MS 100
+#define MINUTES 180
+
+typedef AS3935DutyCycle<SparkFun_AS3935_Emulated> dutyCycleEmulated; 
+
+// startWakeUp(false) to the end, 100us a round. Prints how long it took and
+// whether it calibrated. 
+static void wakeReusing(const char *_title, SparkFun_AS3935_Emulated &_sensor, AS3935Emulator &_emu)
+{
+  uint32_t _before = _emu.nowMicros(); 
+  _sensor.startWakeUp(false); 
+  while(!_sensor.step())
+    _emu.advanceMicros(100); 
+  bool _calibrated = (_sensor.calibrationAge() != 0xFFFFFFFF); 
+  printf("  %-40s %s in %5lu us, %s\n", _title, _sensor.isReady() ? "ready" : "failed",
+    (unsigned long)(_emu.nowMicros() - _before), _calibrated ? "calibrated" : "calibration skipped"); 
+}
+
+int main()
+{
+  AS3935Emulator emu; 
+  SparkFun_AS3935_Emulated lightning(AS3935EmulatorTransport(&emu, 400000, false)); 
+  lightning.useShadowRegisters(true); 
+  lightning.startBegin(); 
+  while(!lightning.step()) ; 
+
+  AS3935Config config; 
+  config.indoorOutdoor = OUTDOOR; 
+  config.noiseLevel = 3; 
+  lightning.applyConfig(config); 
+
+  dutyCycleEmulated schedule(lightning); 
+  schedule.begin(config); 
+
+  uint32_t strikesSent = 0, strikesSeen = 0; 
+  printf("Duty cycled AS3935, %d minutes simulated\n", MINUTES); 
+  printf("  minute  state      duty cycle  wakes  failures  last wake us  max wake us\n"); 
+
+  for(uint32_t _tick = 0; _tick < (MINUTES * 60000UL / TICK_MS); _tick++){
+    uint32_t _minute = _tick * TICK_MS / 60000UL; 
+    uint32_t _inMinute = (_tick * TICK_MS) % 60000UL; 
+
+    if( (_minute >= 90) && (_minute < 120) && ((_inMinute % 30000UL) == 0) ){
+      emu.injectLightning(0x3000, 25 - (_minute - 90) / 2); 
+      strikesSent++; 
+    }
+    if( (_minute == 47) && (_inMinute == 0) )
+      schedule.trigger(); 
+
+    if(emu.irqLine()){
+      lightning.notifyIrq(); 
+      emu.advanceMicros(IRQ_SETTLE_US); 
+      lightningEvent _event; 
+      pollStatus _status = lightning.poll(_event); 
+      if( (_status == POLL_EVENT) || (_status == POLL_LATE_EVENT) ){
+        if(_event.interrupt == LIGHTNING)
+          strikesSeen++; 
+        schedule.record(_event.interrupt); 
+      }
+    }
+    schedule.service(); 
+    // The loop spins while a wake up is in progress, 100us a round. 
+    while(schedule.state() == DUTY_WAKING){
+      emu.advanceMicros(100); 
+      schedule.service(); 
+    }
+    emu.advanceMicros(TICK_MS * 1000UL - (emu.nowMicros() % (TICK_MS * 1000UL))); 
+
+    if( (_inMinute == 60000UL - TICK_MS) && (((_minute + 1) % 15) == 0) ){
+      const dutyCycleStats &_stats = schedule.stats(); 
+      static const char *_states[] = { "listening", "sleeping", "waking" }; 
+      printf("  %6lu  %-9s  %8u.%u%%  %5u  %8u  %12lu  %11lu\n", (unsigned long)(_minute + 1),
+        _states[schedule.state()], schedule.dutyCyclePermille() / 10, schedule.dutyCyclePermille() % 10,
+        _stats.wakes, _stats.wakeFailures, (unsigned long)_stats.lastWakeMicros, (unsigned long)_stats.maxWakeMicros); 
+    }
+  }
+  printf("  strikes reported %lu of %lu\n", (unsigned long)strikesSeen, (unsigned long)strikesSent); 
+
+  // A second node whose microcontroller restarts, e.g. out of its own deep
+  // sleep, while the AS3935 stays powered and calibrated. 
+  printf("\nRe-attaching with startWakeUp(false)\n"); 
+  AS3935Emulator node; 
+  SparkFun_AS3935_Emulated before(AS3935EmulatorTransport(&node, 400000, false)); 
+  before.startBegin(); 
+  while(!before.step())
+    node.advanceMicros(100); 
+  node.advanceMillis(60000); 
+  SparkFun_AS3935_Emulated restarted(AS3935EmulatorTransport(&node, 400000, false)); 
+  wakeReusing("microcontroller restarted, IC listening", restarted, node); 
+  restarted.powerDown(); 
+  node.advanceMillis(60000); 
+  wakeReusing("after powerDown()", restarted, node); 
+  return 0; 
+}
@@ -0,0 +1,306 @@
+/*
+  Checks the Linux transports without hardware. An as3935LinuxIo stand-in
+  records every ioctl and answers reads from a register array, and the test
+  checks the I2C_RDWR messages (register write and data read joined by a
+  repeated start, writes as one message), the adapter timeout and how a
+  transfer the adapter gave up on is reported, the spidev transfers (chip
+  select HIGH, LOW, HIGH at the end of a read) that the transports emit,
+  directly, through the driver and through AS3935CommandQueue, and that
+  notifyIrq() from a GPIO thread waits for the lock poll() holds. Run with
+  ctest, or the CMake target as3935_linux_transport_test.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <linux/spi/spidev.h>
+#include "SparkFun_AS3935_Linux.h"
+#include "SparkFun_AS3935_CommandQueue.h"
+
+#define FAKE_FD 7
+
+static int failures = 0; 
+
+#define CHECK(_cond) do { if(!(_cond)){ printf("%s:%d: %s\n", __FILE__, __LINE__, #_cond); failures++; } } while(0)
+
+// What the stand-in saw and answers with. Copies are taken during the ioctl,
+// the caller's buffers are gone afterwards.
+struct fakeBus {
+  uint8_t regs[0x40]; 
+  int fails;              // ioctls left to fail.
+  int failErrno;          // errno they fail with.
+  unsigned long timeout;  // I2C_TIMEOUT, in 10ms steps.
+  unsigned long request;  // Last ioctl.
+  uint32_t calls; 
+  // I2C_RDWR.
+  uint32_t nmsgs; 
+  struct i2c_msg msgs[2]; 
+  uint8_t data[2][16]; 
+  // SPI_IOC_MESSAGE.
+  uint32_t nxfers; 
+  struct spi_ioc_transfer xfers[2]; 
+  uint8_t tx[2][16]; 
+  // SPI setup.
+  uint8_t mode; 
+  uint8_t bits; 
+  uint32_t speed; 
+  uint32_t closes; 
+};
+
+static fakeBus bus; 
+
+static int fakeOpen(const char *, int) { return FAKE_FD; }
+static int fakeClose(int) { bus.closes++; return 0; }
+
+static int fakeIoctl(int _fd, unsigned long _request, void *_arg)
+{
+  bus.request = _request; 
+  bus.calls++; 
+  if( (_fd != FAKE_FD) || (bus.fails > 0 && bus.fails--) ){
+    errno = bus.failErrno; 
+    return -1; 
+  }
+  if(_request == I2C_TIMEOUT){
+    bus.timeout = (unsigned long)_arg; 
+    return 0; 
+  }
+
+  if(_request == I2C_RDWR){
+    struct i2c_rdwr_ioctl_data *_transfer = (struct i2c_rdwr_ioctl_data *)_arg; 
+    bus.nmsgs = _transfer->nmsgs; 
+    uint8_t _reg = 0; 
+    for(uint32_t i = 0; (i < _transfer->nmsgs) && (i < 2); i++){
+      struct i2c_msg &_msg = _transfer->msgs[i]; 
+      bus.msgs[i] = _msg; 
+      if(_msg.flags & I2C_M_RD){
+        for(uint16_t b = 0; b < _msg.len; b++)
+          _msg.buf[b] = bus.regs[(_reg + b) & 0x3F]; 
+        continue; 
+      }
+      memcpy(bus.data[i], _msg.buf, _msg.len); 
+      _reg = _msg.buf[0]; 
+      for(uint16_t b = 1; b < _msg.len; b++)
+        bus.regs[(_reg + b - 1) & 0x3F] = _msg.buf[b]; 
+    }
+    return 0; 
+  }
+  if(_request == SPI_IOC_WR_MODE){ bus.mode = *(uint8_t *)_arg; return 0; }
+  if(_request == SPI_IOC_WR_BITS_PER_WORD){ bus.bits = *(uint8_t *)_arg; return 0; }
+  if(_request == SPI_IOC_WR_MAX_SPEED_HZ){ bus.speed = *(uint32_t *)_arg; return 0; }
+
+  uint32_t _count = (_request == SPI_IOC_MESSAGE(2)) ? 2 : (_request == SPI_IOC_MESSAGE(1)) ? 1 : 0; 
+  if(_count == 0)
+    return -1; 
+  struct spi_ioc_transfer *_xfers = (struct spi_ioc_transfer *)_arg; 
+  bus.nxfers = _count; 
+  for(uint32_t i = 0; i < _count; i++){
+    bus.xfers[i] = _xfers[i]; 
+    if(_xfers[i].len == 0)
+      continue; 
+    const uint8_t *_tx = (const uint8_t *)(unsigned long)_xfers[i].tx_buf; 
+    uint8_t *_rx = (uint8_t *)(unsigned long)_xfers[i].rx_buf; 
+    memcpy(bus.tx[i], _tx, _xfers[i].len); 
+    uint8_t _reg = _tx[0] & 0x3F; 
+    bool _read = (_tx[0] & SPI_READ_M) != 0; 
+    for(uint32_t b = 1; b < _xfers[i].len; b++){
+      if(_read && _rx)
+        _rx[b] = bus.regs[(_reg + b - 1) & 0x3F]; 
+      else if(!_read)
+        bus.regs[(_reg + b - 1) & 0x3F] = _tx[b]; 
+    }
+  }
+  return 0; 
+}
+
+static const as3935LinuxIo fakeIo = { fakeOpen, fakeIoctl, fakeClose }; 
+
+static void resetBus()
+{
+  memset(&bus, 0, sizeof(bus)); 
+  for(uint8_t i = 0; i < 0x40; i++)
+    bus.regs[i] = 0xA0 + i; 
+}
+
+static void testI2C()
+{
+  resetBus(); 
+  AS3935LinuxI2CTransport _i2c("/dev/i2c-fake", AS3935_DEFAULT_ADDRESS, fakeIo); 
+  uint8_t _buf[3] = { 0 }; 
+  CHECK(_i2c.readRegisters(ENERGY_LIGHT_LSB, _buf, 3) == 0); // Not opened yet.
+  CHECK(bus.calls == 0); 
+  _i2c.begin(); 
+  CHECK(bus.timeout == 1); 
+
+  // Read: register write, then a repeated start read, in one ioctl.
+  CHECK(_i2c.readRegisters(ENERGY_LIGHT_LSB, _buf, 3) == 3); 
+  CHECK(bus.request == I2C_RDWR); 
+  CHECK(bus.nmsgs == 2); 
+  CHECK(bus.msgs[0].addr == AS3935_DEFAULT_ADDRESS); 
+  CHECK(bus.msgs[0].flags == 0); 
+  CHECK(bus.msgs[0].len == 1); 
+  CHECK(bus.data[0][0] == ENERGY_LIGHT_LSB); 
+  CHECK(bus.msgs[1].addr == AS3935_DEFAULT_ADDRESS); 
+  CHECK(bus.msgs[1].flags == I2C_M_RD); 
+  CHECK(bus.msgs[1].len == 3); 
+  CHECK( (_buf[0] == 0xA4) && (_buf[1] == 0xA5) && (_buf[2] == 0xA6) ); 
+
+  // Write: one message of the register followed by the data.
+  const uint8_t _out[2] = { 0x24, 0x32 }; 
+  CHECK(_i2c.writeRegisters(AFE_GAIN, _out, 2)); 
+  CHECK(bus.nmsgs == 1); 
+  CHECK(bus.msgs[0].flags == 0); 
+  CHECK(bus.msgs[0].len == 3); 
+  CHECK( (bus.data[0][0] == AFE_GAIN) && (bus.data[0][1] == 0x24) && (bus.data[0][2] == 0x32) ); 
+
+  // A failed ioctl is a failed transfer.
+  bus.fails = 1; 
+  CHECK(_i2c.readRegisters(AFE_GAIN, _buf, 1) == 0); 
+  bus.fails = 1; 
+  CHECK(!_i2c.writeRegisters(AFE_GAIN, _out, 1)); 
+  bus.fails = 1; 
+  CHECK(!_i2c.probe()); 
+  CHECK(_i2c.probe()); 
+
+  // The non-blocking calls tell a timed out transfer from a NACK.
+  CHECK(_i2c.startRead(AFE_GAIN, _buf, 1)); 
+  CHECK(_i2c.pollTransfer() == TRANSFER_DONE); 
+  bus.fails = 1; 
+  bus.failErrno = ENXIO; 
+  CHECK(_i2c.startRead(AFE_GAIN, _buf, 1)); 
+  CHECK(_i2c.pollTransfer() == TRANSFER_FAILED); 
+  bus.fails = 1; 
+  bus.failErrno = ETIMEDOUT; 
+  CHECK(_i2c.startWrite(AFE_GAIN, _out, 1)); 
+  CHECK(_i2c.pollTransfer() == TRANSFER_TIMEOUT); 
+  bus.fails = 1; 
+  CHECK(_i2c.startRead(AFE_GAIN, _buf, 1)); 
+  CHECK(_i2c.pollTransfer() == TRANSFER_TIMEOUT); 
+
+  _i2c.end(); 
+  CHECK(bus.closes == 1); 
+
+  // Rounded up to 10ms steps.
+  _i2c.setTransferTimeout(25000); 
+  _i2c.begin(); 
+  CHECK(bus.timeout == 3); 
+  _i2c.end(); 
+}
+
+static void testSPI()
+{
+  resetBus(); 
+  AS3935LinuxSPITransport _spi("/dev/spidev-fake", 2000000, fakeIo); 
+  _spi.begin(); 
+  CHECK(_spi.probe()); 
+  CHECK(bus.mode == SPI_MODE_1); 
+  CHECK(bus.bits == 8); 
+  CHECK(bus.speed == 2000000); 
+
+  // Read: the data transfer ends with chip select HIGH and LOW again
+  // (cs_change), the empty one after it raises it for good.
+  uint8_t _buf[5] = { 0 }; 
+  CHECK(_spi.readRegisters(INT_MASK_ANT, _buf, 5) == 5); 
+  CHECK(bus.request == SPI_IOC_MESSAGE(2)); 
+  CHECK(bus.nxfers == 2); 
+  CHECK(bus.xfers[0].len == 6); 
+  CHECK(bus.tx[0][0] == (INT_MASK_ANT | SPI_READ_M)); 
+  CHECK(bus.xfers[0].cs_change == 1); 
+  CHECK(bus.xfers[0].speed_hz == 2000000); 
+  CHECK(bus.xfers[1].len == 0); 
+  CHECK(bus.xfers[1].cs_change == 0); 
+  CHECK( (_buf[0] == 0xA3) && (_buf[4] == 0xA7) ); 
+
+  // Write: a single transfer, chip select released at its end.
+  const uint8_t _out[1] = { 0x96 }; 
+  CHECK(_spi.writeRegisters(DEFAULT_RESET, _out, 1)); 
+  CHECK(bus.request == SPI_IOC_MESSAGE(1)); 
+  CHECK(bus.xfers[0].len == 2); 
+  CHECK( (bus.tx[0][0] == DEFAULT_RESET) && (bus.tx[0][1] == 0x96) ); 
+  CHECK(bus.xfers[0].cs_change == 0); 
+
+  bus.fails = 1; 
+  CHECK(_spi.readRegisters(AFE_GAIN, _buf, 1) == 0); 
+
+  // A device that rejects the setup is closed again.
+  AS3935LinuxSPITransport _bad("/dev/spidev-fake", 2000000, fakeIo); 
+  bus.fails = 1; 
+  bus.closes = 0; 
+  _bad.begin(); 
+  CHECK(!_bad.probe()); 
+  CHECK(bus.closes == 1); 
+}
+
+// One setter through the driver: the register is read, then written with
+// only its field changed.
+static void testDriver()
+{
+  resetBus(); 
+  bus.regs[THRESHOLD] = 0x22; 
+  SparkFun_AS3935_LinuxI2C _lightning{AS3935LinuxI2CTransport("/dev/i2c-fake", AS3935_DEFAULT_ADDRESS, fakeIo)}; 
+  _lightning.transport().begin(); 
+  _lightning.setNoiseLevel(5); 
+  CHECK(bus.request == I2C_RDWR); 
+  CHECK(bus.nmsgs == 1); 
+  CHECK( (bus.data[0][0] == THRESHOLD) && (bus.data[0][1] == 0x52) ); 
+  CHECK(_lightning.readNoiseLevel() == 5); 
+}
+
+static void onCommand(commandResult _result, uint8_t, const uint8_t *, uint8_t, void *_context)
+{
+  *(commandResult *)_context = _result; 
+}
+
+// A transfer the adapter gave up on is a timeout for the queue as well, the
+// queue's own timeout never sees it running. 
+static void testQueueTimeout()
+{
+  resetBus(); 
+  SparkFun_AS3935_LinuxI2C _lightning{AS3935LinuxI2CTransport("/dev/i2c-fake", AS3935_DEFAULT_ADDRESS, fakeIo)}; 
+  _lightning.transport().begin(); 
+  AS3935CommandQueue<2, SparkFun_AS3935_LinuxI2C> _queue(_lightning); 
+  commandResult _first = COMMAND_CANCELLED, _second = COMMAND_CANCELLED; 
+  _queue.read(AFE_GAIN, 1, onCommand, &_first); 
+  _queue.read(AFE_GAIN, 1, onCommand, &_second); 
+  bus.fails = 1; 
+  bus.failErrno = ETIMEDOUT; 
+  while(_queue.service()) ; 
+  CHECK(_first == COMMAND_TIMEOUT); 
+  CHECK(_second == COMMAND_OK); 
+  CHECK( (_queue.timeouts() == 1) && (_queue.busErrors() == 0) ); 
+}
+
+static void *notifyThread(void *_driver)
+{
+  ((SparkFun_AS3935_LinuxI2C *)_driver)->notifyIrq(); 
+  return NULL; 
+}
+
+// While the main thread holds the lock, as poll() does, an edge reported
+// from another thread must not land. 
+static void testIrqLock()
+{
+  SparkFun_AS3935_LinuxI2C _lightning{AS3935LinuxI2CTransport("/dev/i2c-fake", AS3935_DEFAULT_ADDRESS, fakeIo)}; 
+  pthread_t _thread; 
+  _lightning.transport().disableIrq(); 
+  pthread_create(&_thread, NULL, notifyThread, &_lightning); 
+  usleep(20000); 
+  CHECK(!_lightning.irqPending()); 
+  _lightning.transport().enableIrq(); 
+  pthread_join(_thread, NULL); 
+  CHECK(_lightning.irqPending()); 
+}
+
+int main()
+{
+  testI2C(); 
+  testSPI(); 
+  testDriver(); 
+  testQueueTimeout(); 
+  testIrqLock(); 
+  printf("%s, %d failures\n", failures ? "FAILED" : "passed", failures); 
+  return failures ? 1 : 0; 
+}
@@ -0,0 +1,177 @@
+/*
+  Checks the register bytes every setter leaves in the register emulator,
+  with and without the shadow cache: each field lands in its own bits,
+  clears its old value and leaves the other fields of the register alone.
+  Out of range values write nothing. Covers the packing of setIndoorOutdoor(),
+  watchdogThreshold(), setNoiseLevel(), spikeRejection(),
+  lightningThreshold(), clearStatistics(), maskDisturber(), antennaTuning(),
+  tuneCap(), displayOscillator() and powerDown(). Run with ctest, or the
+  CMake target as3935_register_fields_test.
+*/
+
+#include <stdio.h>
+#include "SparkFun_AS3935_Emulator.h"
+
+static int failures = 0; 
+
+// Compares a register of the emulator, without the side effects of a read.
+#define CHECK_REG(_reg, _expected) checkRegister(__LINE__, bench.emu, _reg, _expected, _shadow)
+#define CHECK(_cond) do { if(!(_cond)){ printf("%s:%d: %s\n", __FILE__, __LINE__, #_cond); failures++; } } while(0)
+
+static void checkRegister(int _line, const AS3935Emulator &_emu, uint8_t _reg, uint8_t _expected, bool _shadow)
+{
+  uint8_t _actual = _emu.peek(_reg); 
+  if(_actual == _expected)
+    return; 
+  printf("%s:%d: REG0x%02X is 0x%02X, expected 0x%02X (shadow %s)\n", __FILE__, _line, _reg, _actual,
+    _expected, _shadow ? "on" : "off"); 
+  failures++; 
+}
+
+// A started detector on a fresh IC: REG0x00 0x24, REG0x01 0x22, REG0x02 0xC2,
+// REG0x03 0x00 and REG0x08 0x00.
+struct testBench {
+  AS3935Emulator emu; 
+  SparkFun_AS3935_Emulated lightning; 
+
+  testBench(bool _shadow) : lightning(AS3935EmulatorTransport(&emu))
+  {
+    lightning.begin(); 
+    lightning.useShadowRegisters(_shadow); 
+  }
+};
+
+// REG0x00 [5:1] and [0].
+static void testAfeGain(bool _shadow)
+{
+  testBench bench(_shadow); 
+  bench.lightning.setIndoorOutdoor(OUTDOOR); 
+  CHECK_REG(AFE_GAIN, 0x1C); 
+  bench.lightning.setIndoorOutdoor(INDOOR); 
+  CHECK_REG(AFE_GAIN, 0x24); 
+  bench.lightning.setIndoorOutdoor(0x05); 
+  CHECK_REG(AFE_GAIN, 0x24); 
+  CHECK(bench.lightning.readIndoorOutdoor() == INDOOR); 
+
+  bench.lightning.powerDown(); 
+  CHECK_REG(AFE_GAIN, 0x25); 
+  bench.lightning.setIndoorOutdoor(OUTDOOR); 
+  CHECK_REG(AFE_GAIN, 0x1D); 
+}
+
+// REG0x01 [6:4] and [3:0].
+static void testThreshold(bool _shadow)
+{
+  testBench bench(_shadow); 
+  bench.lightning.watchdogThreshold(10); 
+  CHECK_REG(THRESHOLD, 0x2A); 
+  bench.lightning.watchdogThreshold(1); 
+  CHECK_REG(THRESHOLD, 0x21); 
+  bench.lightning.watchdogThreshold(11); 
+  CHECK_REG(THRESHOLD, 0x21); 
+
+  bench.lightning.setNoiseLevel(7); 
+  CHECK_REG(THRESHOLD, 0x71); 
+  bench.lightning.setNoiseLevel(1); 
+  CHECK_REG(THRESHOLD, 0x11); 
+  bench.lightning.setNoiseLevel(0); 
+  CHECK_REG(THRESHOLD, 0x11); 
+  CHECK(bench.lightning.readNoiseLevel() == 1); 
+  CHECK(bench.lightning.readWatchdogThreshold() == 1); 
+}
+
+// REG0x02 [6], [5:4] and [3:0]. The emulator keeps only these bits, so the
+// reserved bit 7 of the 0xC2 default is gone after the first write.
+static void testLightningReg(bool _shadow)
+{
+  testBench bench(_shadow); 
+  bench.lightning.spikeRejection(11); 
+  CHECK_REG(LIGHTNING_REG, 0x4B); 
+  bench.lightning.spikeRejection(1); 
+  CHECK_REG(LIGHTNING_REG, 0x41); 
+  bench.lightning.spikeRejection(12); 
+  CHECK_REG(LIGHTNING_REG, 0x41); 
+
+  bench.lightning.lightningThreshold(5); 
+  CHECK_REG(LIGHTNING_REG, 0x51); 
+  bench.lightning.lightningThreshold(9); 
+  CHECK_REG(LIGHTNING_REG, 0x61); 
+  bench.lightning.lightningThreshold(16); 
+  CHECK_REG(LIGHTNING_REG, 0x71); 
+  bench.lightning.lightningThreshold(3); 
+  CHECK_REG(LIGHTNING_REG, 0x71); 
+  CHECK(bench.lightning.readLightningThreshold() == 16); 
+  bench.lightning.lightningThreshold(1); 
+  CHECK_REG(LIGHTNING_REG, 0x41); 
+
+  // HIGH, LOW, HIGH: ends as it started.
+  bench.lightning.clearStatistics(true); 
+  CHECK_REG(LIGHTNING_REG, 0x41); 
+  CHECK(bench.lightning.readSpikeRejection() == 1); 
+}
+
+// REG0x03 [7:6] and [5], the interrupt bits [3:0] are read only.
+static void testIntMaskAnt(bool _shadow)
+{
+  testBench bench(_shadow); 
+  bench.lightning.maskDisturber(true); 
+  CHECK_REG(INT_MASK_ANT, 0x20); 
+  bench.lightning.antennaTuning(32); 
+  CHECK_REG(INT_MASK_ANT, 0x60); 
+  bench.lightning.antennaTuning(64); 
+  CHECK_REG(INT_MASK_ANT, 0xA0); 
+  bench.lightning.antennaTuning(128); 
+  CHECK_REG(INT_MASK_ANT, 0xE0); 
+  bench.lightning.antennaTuning(100); 
+  CHECK_REG(INT_MASK_ANT, 0xE0); 
+  CHECK(bench.lightning.readAntennaTuning() == 128); 
+  bench.lightning.maskDisturber(false); 
+  CHECK_REG(INT_MASK_ANT, 0xC0); 
+  bench.lightning.antennaTuning(16); 
+  CHECK_REG(INT_MASK_ANT, 0x00); 
+  CHECK(!bench.lightning.readMaskDisturber()); 
+}
+
+// REG0x08 [7], [6], [5] and [3:0].
+static void testFreqDispIrq(bool _shadow)
+{
+  testBench bench(_shadow); 
+  bench.lightning.tuneCap(15); 
+  CHECK_REG(FREQ_DISP_IRQ, 0x0F); 
+  bench.lightning.tuneCap(8); 
+  CHECK_REG(FREQ_DISP_IRQ, 0x08); 
+  bench.lightning.tuneCap(0); 
+  CHECK_REG(FREQ_DISP_IRQ, 0x00); 
+  bench.lightning.tuneCap(16); 
+  CHECK_REG(FREQ_DISP_IRQ, 0x00); 
+
+  bench.lightning.tuneCap(9); 
+  bench.lightning.displayOscillator(true, 3); 
+  CHECK_REG(FREQ_DISP_IRQ, 0x89); 
+  bench.lightning.displayOscillator(true, 2); 
+  CHECK_REG(FREQ_DISP_IRQ, 0xC9); 
+  bench.lightning.displayOscillator(true, 1); 
+  CHECK_REG(FREQ_DISP_IRQ, 0xE9); 
+  bench.lightning.displayOscillator(false, 3); 
+  CHECK_REG(FREQ_DISP_IRQ, 0x69); 
+  bench.lightning.displayOscillator(false, 2); 
+  CHECK_REG(FREQ_DISP_IRQ, 0x29); 
+  bench.lightning.displayOscillator(false, 4); 
+  CHECK_REG(FREQ_DISP_IRQ, 0x29); 
+  bench.lightning.displayOscillator(false, 1); 
+  CHECK_REG(FREQ_DISP_IRQ, 0x09); 
+  CHECK(bench.lightning.readTuneCap() == 9); 
+}
+
+int main()
+{
+  for(uint8_t _shadow = 0; _shadow < 2; _shadow++){
+    testAfeGain(_shadow); 
+    testThreshold(_shadow); 
+    testLightningReg(_shadow); 
+    testIntMaskAnt(_shadow); 
+    testFreqDispIrq(_shadow); 
+  }
+  printf("%s, %d failures\n", failures ? "FAILED" : "passed", failures); 
+  return failures ? 1 : 0; 
+}
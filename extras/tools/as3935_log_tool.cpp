@@ -0,0 +1,226 @@
+/*
+  Host side companion of SparkFun_AS3935_EventLog.h.
+
+    as3935_log_tool generate <file>   Writes a sample log: two detectors on
+                                      the register emulator through a
+                                      simulated storm, read with poll().
+    as3935_log_tool decode <file>     Prints a log as CSV.
+    as3935_log_tool replay <file>     Plays a log back into the emulator, one
+                                      emulated detector per sensor id, and
+                                      reads it through AS3935Manager and
+                                      poll() like a live system would. Every
+                                      event read back is checked against the
+                                      log.
+
+  Build with the CMake target as3935_log_tool.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "SparkFun_AS3935_Emulator.h"
+#include "SparkFun_AS3935_EventLog.h"
+#include "SparkFun_AS3935_Manager.h"
+
+#define LOG_SENSORS LOG_MAX_SENSORS
+
+typedef AS3935Manager<LOG_SENSORS, SparkFun_AS3935_Emulated> emulatedManager; 
+
+// Lets the encoder write straight into a FILE.
+struct FileSink {
+  FILE *file; 
+  size_t write(const uint8_t *_buf, size_t _len) { return fwrite(_buf, 1, _len, file); }
+};
+
+static const char *typeName(uint8_t _interrupt)
+{
+  switch(_interrupt){
+    case NOISE_TO_HIGH:    return "noise"; 
+    case DISTURBER_DETECT: return "disturber"; 
+    case LIGHTNING:        return "lightning"; 
+    default:               return "empty"; 
+  }
+}
+
+// Small deterministic generator for the sample log.
+static uint32_t _seed = 2024; 
+static uint32_t nextRandom(uint32_t _range)
+{
+  _seed = _seed * 1664525UL + 1013904223UL; 
+  return (_seed >> 8) % _range; 
+}
+
+static int generate(const char *_path)
+{
+  FILE *_file = fopen(_path, "wb"); 
+  if(_file == NULL){
+    perror(_path); 
+    return 1; 
+  }
+  FileSink _sink = { _file }; 
+  AS3935LogEncoder _encoder; 
+
+  AS3935Emulator _emu[2]; 
+  AS3935EmulatorTransport _bus0(&_emu[0]), _bus1(&_emu[1]); 
+  SparkFun_AS3935_Emulated _sensor0(_bus0); 
+  SparkFun_AS3935_Emulated _sensor1(_bus1); 
+  SparkFun_AS3935_Emulated *_sensors[2] = { &_sensor0, &_sensor1 }; 
+  for(uint8_t s = 0; s < 2; s++)
+    _sensors[s]->begin(); 
+
+  uint32_t _events = 0, _bytes = 0; 
+  for(uint32_t _tick = 0; _tick < 30UL * 60UL * 10UL; _tick++){ // 30 minutes of 100ms.
+    for(uint8_t s = 0; s < 2; s++){
+      uint32_t _roll = nextRandom(1000); 
+      if(_roll < 8)
+        _emu[s].injectLightning(nextRandom(0x100000), 1 + nextRandom(40)); 
+      else if(_roll < 20)
+        _emu[s].injectDisturber(); 
+      else if(_roll < 22)
+        _emu[s].injectNoise(); 
+
+      if(_emu[s].irqLine()){
+        _sensors[s]->notifyIrq(); 
+        _emu[s].advanceMicros(IRQ_SETTLE_US); 
+        lightningEvent _event; 
+        pollStatus _status = _sensors[s]->poll(_event); 
+        if( (_status == POLL_EVENT) || (_status == POLL_LATE_EVENT) ){
+          _bytes += _encoder.write(_sink, _event, s, _status == POLL_LATE_EVENT); 
+          _events++; 
+        }
+      }
+      _emu[s].advanceMicros(100000UL - (_emu[s].nowMicros() % 100000UL)); 
+    }
+  }
+  fclose(_file); 
+  printf("%s: %lu events in %lu bytes, %.1f bytes per event\n", _path, (unsigned long)_events,
+    (unsigned long)_bytes, _events ? (double)_bytes / _events : 0.0); 
+  return 0; 
+}
+
+static int decode(const char *_path)
+{
+  FILE *_file = fopen(_path, "rb"); 
+  if(_file == NULL){
+    perror(_path); 
+    return 1; 
+  }
+  AS3935LogDecoder _decoder; 
+  logEntry _entry; 
+  int _byte; 
+  printf("timestamp_ms,sensor,type,energy,distance_km,late\n"); 
+  while( (_byte = fgetc(_file)) != EOF ){
+    if(_decoder.push((uint8_t)_byte, _entry))
+      printf("%lu,%u,%s,%lu,%u,%u\n", (unsigned long)_entry.event.timestamp, _entry.sensor,
+        typeName(_entry.event.interrupt), (unsigned long)_entry.event.energy,
+        _entry.event.distance, _entry.late); 
+  }
+  fclose(_file); 
+  if(_decoder.errors())
+    fprintf(stderr, "%lu corrupt bytes skipped\n", (unsigned long)_decoder.errors()); 
+  return 0; 
+}
+
+// What the replay expects the manager to read back next.
+struct Replay {
+  logEntry expected; 
+  bool read; 
+  uint32_t matched; 
+  uint32_t mismatched; 
+};
+
+static void onReplayedEvent(uint8_t _sensor, const lightningEvent &_event, pollStatus, void *_context)
+{
+  Replay *_replay = (Replay *)_context; 
+  const lightningEvent &_want = _replay->expected.event; 
+  _replay->read = true; 
+  bool _same = (_sensor == _replay->expected.sensor) && (_event.interrupt == _want.interrupt) &&
+    ( (_event.interrupt != LIGHTNING) || ((_event.energy == _want.energy) && (_event.distance == _want.distance)) ); 
+  if(_same)
+    _replay->matched++; 
+  else {
+    _replay->mismatched++; 
+    printf("mismatch at %lu ms: logged %s on sensor %u, read %s on sensor %u\n",
+      (unsigned long)_want.timestamp, typeName(_want.interrupt), _replay->expected.sensor,
+      typeName(_event.interrupt), _sensor); 
+  }
+}
+
+static int replay(const char *_path)
+{
+  FILE *_file = fopen(_path, "rb"); 
+  if(_file == NULL){
+    perror(_path); 
+    return 1; 
+  }
+
+  // One emulated detector per sensor id, all on the log's clock.
+  static AS3935Emulator _emu[LOG_SENSORS]; 
+  static SparkFun_AS3935_Emulated *_sensors[LOG_SENSORS]; 
+  Replay _replay; 
+  memset(&_replay, 0, sizeof(_replay)); 
+  emulatedManager _manager(onReplayedEvent, &_replay); 
+  for(uint8_t s = 0; s < LOG_SENSORS; s++){
+    _sensors[s] = new SparkFun_AS3935_Emulated(AS3935EmulatorTransport(&_emu[s])); 
+    _sensors[s]->begin(); 
+    _manager.addSensor(*_sensors[s]); 
+  }
+
+  AS3935LogDecoder _decoder; 
+  uint32_t _skipped = 0; 
+  int _byte; 
+  while( (_byte = fgetc(_file)) != EOF ){
+    if(!_decoder.push((uint8_t)_byte, _replay.expected))
+      continue; 
+    const logEntry &_entry = _replay.expected; 
+    if(_entry.event.interrupt == 0){
+      _skipped++; // Nothing the IC could be made to raise.
+      continue; 
+    }
+
+    for(uint8_t s = 0; s < LOG_SENSORS; s++){
+      uint32_t _now = _emu[s].nowMillis(); 
+      if((int32_t)(_entry.event.timestamp - _now) > 0)
+        _emu[s].advanceMillis(_entry.event.timestamp - _now); 
+    }
+    AS3935Emulator &_target = _emu[_entry.sensor]; 
+    if(_entry.event.interrupt == LIGHTNING)
+      _target.injectLightning(_entry.event.energy, _entry.event.distance); 
+    else if(_entry.event.interrupt == DISTURBER_DETECT)
+      _target.injectDisturber(); 
+    else
+      _target.injectNoise(); 
+
+    _manager.notifyIrq(_entry.sensor); 
+    for(uint8_t s = 0; s < LOG_SENSORS; s++)
+      _emu[s].advanceMicros(IRQ_SETTLE_US); 
+    _replay.read = false; 
+    _manager.service(); 
+    if(!_replay.read){
+      _replay.mismatched++; 
+      printf("missed at %lu ms: logged %s on sensor %u\n", (unsigned long)_entry.event.timestamp,
+        typeName(_entry.event.interrupt), _entry.sensor); 
+    }
+  }
+  fclose(_file); 
+
+  printf("%lu events replayed through the driver, %lu matched, %lu did not, %lu empty skipped\n",
+    (unsigned long)(_replay.matched + _replay.mismatched), (unsigned long)_replay.matched,
+    (unsigned long)_replay.mismatched, (unsigned long)_skipped); 
+  for(uint8_t s = 0; s < LOG_SENSORS; s++)
+    delete _sensors[s]; 
+  return _replay.mismatched ? 1 : 0; 
+}
+
+int main(int argc, char **argv)
+{
+  if(argc == 3){
+    if(strcmp(argv[1], "generate") == 0)
+      return generate(argv[2]); 
+    if(strcmp(argv[1], "decode") == 0)
+      return decode(argv[2]); 
+    if(strcmp(argv[1], "replay") == 0)
+      return replay(argv[2]); 
+  }
+  fprintf(stderr, "usage: %s generate|decode|replay <file>\n", argv[0]); 
+  return 2; 
+}
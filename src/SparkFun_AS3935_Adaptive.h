@@ -0,0 +1,170 @@
+#ifndef _SPARKFUN_AS3935_ADAPTIVE_H_
+#define _SPARKFUN_AS3935_ADAPTIVE_H_
+
+#include "SparkFun_AS3935_Core.h"
+
+// Defined in SparkFun_AS3935.h, include that first on Arduino.
+class SparkFun_AS3935; 
+
+// Tuning of AS3935AdaptiveController. Rates are counted per window, a step
+// up happens as soon as a window reaches its high mark, a step down only
+// after decayWindows windows in a row at or under the low mark.
+struct adaptiveSettings {
+
+  uint32_t windowMs       = 10000; // Length of one counting window.
+  uint8_t  noiseHigh      = 3;     // INT_NH per window that raise the noise floor.
+  uint8_t  noiseLow       = 0;     // INT_NH per window considered quiet.
+  uint8_t  disturberHigh  = 5;     // INT_D per window that desensitize a step.
+  uint8_t  disturberLow   = 1;     // INT_D per window considered quiet.
+  uint8_t  decayWindows   = 6;     // Quiet windows before one step back down.
+  uint8_t  maxDisturberStep = 4;   // The last step masks disturbers, the ones
+                                   // before raise the watchdog and spike rejection.
+
+};
+
+// Keeps the interrupt rate of a noisy site bounded. Every event read from the
+// detector is handed to record(), and service() is called from the loop.
+// When INT_NH keeps firing the noise floor (REG0x01 [6:4]) goes up one level.
+// When INT_D keeps firing the watchdog threshold (REG0x01 [3:0]) and spike
+// rejection (REG0x02 [3:0]) go up one step each, and at the last step
+// disturbers are masked (REG0x03 [5]) instead. Once the site calms down each
+// setting walks back to the baseline one step at a time. Every change is a
+// single applyConfig(), so the controller adds at most one bus write per
+// step. Sensor is any AS3935Driver, or the SparkFun_AS3935 wrapper by default.
+template <class Sensor = SparkFun_AS3935>
+class AS3935AdaptiveController
+{
+  public:
+    AS3935AdaptiveController(Sensor &_sensor, const adaptiveSettings &_settings = adaptiveSettings()) :
+      _detector(&_sensor), _tuning(_settings) { }
+
+    // Starts from the given configuration, which is also what the controller
+    // decays back to. Returns false if it could not be applied.
+    bool begin(const AS3935Config &_config)
+    {
+      _baseline = _config; 
+      _noiseStep = 0; 
+      _disturberStep = 0; 
+      _adjustments = 0; 
+      restartWindow(); 
+      _quietNoise = 0; 
+      _quietDisturber = 0; 
+      bool _ok = apply(); 
+      _adjustments = 0; 
+      return _ok; 
+    }
+
+    // Counts an event read from the detector, and steps up right away if
+    // this window has reached a high mark.
+    void record(uint8_t _interrupt)
+    {
+      if(_interrupt == NOISE_TO_HIGH){
+        if(_noiseCount < 255)
+          _noiseCount++; 
+        if( (_noiseCount >= _tuning.noiseHigh) && (noiseLevel() < 7) ){
+          _noiseStep++; 
+          _quietNoise = 0; 
+          _noiseCount = 0; 
+          apply(); 
+        }
+      }
+      else if(_interrupt == DISTURBER_DETECT){
+        if(_disturberCount < 255)
+          _disturberCount++; 
+        if( (_disturberCount >= _tuning.disturberHigh) && (_disturberStep < _tuning.maxDisturberStep) ){
+          _disturberStep++; 
+          _quietDisturber = 0; 
+          _disturberCount = 0; 
+          apply(); 
+        }
+      }
+    }
+
+    // Closes the window once it has run out and steps back down after enough
+    // quiet ones. Call it from the loop, it is cheap when nothing is due.
+    void service()
+    {
+      uint32_t _now = _detector->transport().nowMillis(); 
+      if( (_now - _windowStart) < _tuning.windowMs )
+        return; 
+
+      bool _changed = false; 
+      _quietNoise = (_noiseCount <= _tuning.noiseLow) ? _quietNoise + 1 : 0; 
+      if( (_quietNoise >= _tuning.decayWindows) && (_noiseStep > 0) ){
+        _noiseStep--; 
+        _quietNoise = 0; 
+        _changed = true; 
+      }
+      _quietDisturber = (_disturberCount <= _tuning.disturberLow) ? _quietDisturber + 1 : 0; 
+      if( (_quietDisturber >= _tuning.decayWindows) && (_disturberStep > 0) ){
+        _disturberStep--; 
+        _quietDisturber = 0; 
+        _changed = true; 
+      }
+      restartWindow(); 
+      if(_changed)
+        apply(); 
+    }
+
+    // How far above the baseline the controller currently is.
+    uint8_t noiseStep() const { return _noiseStep; }
+    uint8_t disturberStep() const { return _disturberStep; }
+    // The configuration now in the detector.
+    const AS3935Config &current() const { return _current; }
+    // Number of configuration changes made since begin().
+    uint32_t adjustments() const { return _adjustments; }
+
+  private:
+
+    void restartWindow()
+    {
+      _windowStart = _detector->transport().nowMillis(); 
+      _noiseCount = 0; 
+      _disturberCount = 0; 
+    }
+
+    uint8_t noiseLevel() const
+    {
+      uint8_t _level = _baseline.noiseLevel + _noiseStep; 
+      return (_level > 7) ? 7 : _level; 
+    }
+
+    // The baseline plus the current steps, clamped to what the IC accepts.
+    bool apply()
+    {
+      _current = _baseline; 
+      _current.noiseLevel = noiseLevel(); 
+      if( (_disturberStep > 0) && (_disturberStep >= _tuning.maxDisturberStep) ){
+        _current.maskDisturber = true; 
+        _current.watchdog = clampedStep(_baseline.watchdog, _disturberStep - 1, 10); 
+        _current.spike = clampedStep(_baseline.spike, _disturberStep - 1, 11); 
+      }
+      else {
+        _current.watchdog = clampedStep(_baseline.watchdog, _disturberStep, 10); 
+        _current.spike = clampedStep(_baseline.spike, _disturberStep, 11); 
+      }
+      _adjustments++; 
+      return _detector->applyConfig(_current); 
+    }
+
+    static uint8_t clampedStep(uint8_t _value, uint8_t _step, uint8_t _max)
+    {
+      uint16_t _sum = _value + _step; 
+      return (_sum > _max) ? _max : _sum; 
+    }
+
+    Sensor *_detector; 
+    adaptiveSettings _tuning; 
+    AS3935Config _baseline; 
+    AS3935Config _current; 
+    uint8_t _noiseStep = 0; 
+    uint8_t _disturberStep = 0; 
+    uint8_t _noiseCount = 0;     // INT_NH in this window.
+    uint8_t _disturberCount = 0; // INT_D in this window.
+    uint8_t _quietNoise = 0;     // Quiet windows in a row.
+    uint8_t _quietDisturber = 0; 
+    uint32_t _windowStart = 0; 
+    uint32_t _adjustments = 0; 
+
+};
+#endif
@@ -0,0 +1,291 @@
+#ifndef _SPARKFUN_AS3935_COMMANDQUEUE_H_
+#define _SPARKFUN_AS3935_COMMANDQUEUE_H_
+
+#include "SparkFun_AS3935_Core.h"
+
+// Defined in SparkFun_AS3935.h, include that first on Arduino.
+class SparkFun_AS3935; 
+
+// Longest transfer of one command: REG0x00 - REG0x08.
+#define COMMAND_MAX_BYTES 9
+
+// How a command ended, handed to its callback.
+typedef enum SF_AS3935_COMMAND_RESULT {
+
+  COMMAND_OK        = 0,
+  COMMAND_BUS_ERROR,     // A transfer was not acknowledged or failed.
+  COMMAND_TIMEOUT,       // A transfer took longer than the timeout and was aborted.
+  COMMAND_CANCELLED      // clear() dropped the command.
+
+} commandResult; 
+
+// Called once for every command when it is over. _data holds the _len
+// registers from _reg on: what was read for read(), what was written for
+// write(), and for update() and applyConfig() the merged register values, or
+// only the new bits if the read before the merge failed. It is only valid
+// during the call. The callback may queue further commands.
+typedef void (*commandCallback)(commandResult _result, uint8_t _reg, const uint8_t *_data, uint8_t _len, void *_context); 
+
+// Runs register reads, writes and configuration changes of one detector in
+// the background, so that a slow or stuck bus can not hold up the loop.
+// Commands are queued with a callback and carried out in order by service(),
+// which never waits: it checks the running transfer, aborts it once it is
+// older than the timeout, and starts at most one new transfer per call. A
+// failed command does not stop the ones after it. Transfers go through the
+// driver's startRead() and startWrite(). Over a transport whose transfers
+// block (Wire, SPI, Linux) a service() call runs at most one transfer to
+// its end, and only the transport can cut a stuck one short: Wire where the
+// core has setWireTimeout() and i2c-dev after the adapter timeout, both set
+// with setTransferTimeout(), end it with COMMAND_TIMEOUT; an SPI master
+// clocks every byte itself and does not stall. A transport with real
+// non-blocking transfers, e.g. completed from a Wire or DMA interrupt, does
+// not block at all and is aborted after the queue's own timeout; with such
+// a transport make blocking driver calls only while pending() is 0. Writes
+// drop the driver's shadow cache. Sensor is any AS3935Driver, or the
+// SparkFun_AS3935 wrapper by default.
+template <uint8_t N, class Sensor = SparkFun_AS3935>
+class AS3935CommandQueue
+{
+  public:
+    AS3935CommandQueue(Sensor &_sensor, uint32_t _timeoutMicros = TRANSFER_TIMEOUT_US) :
+      _detector(&_sensor), _timeout(_timeoutMicros) { }
+
+    // Reads _len registers from _reg on, 1 to COMMAND_MAX_BYTES. A read of
+    // REG0x03 clears the interrupt on the IC and hands it to the callback
+    // only. Each of the queueing calls returns false, with nothing queued,
+    // when the queue is full or the command is invalid.
+    bool read(uint8_t _reg, uint8_t _len, commandCallback _callback, void *_context = NULL)
+    {
+      queuedCommand *_command = append(COMMAND_READ, _reg, _len, _callback, _context); 
+      return _command != NULL; 
+    }
+
+    // Writes _len bytes from _buf, which is copied, from _reg on.
+    bool write(uint8_t _reg, const uint8_t *_buf, uint8_t _len, commandCallback _callback = NULL, void *_context = NULL)
+    {
+      queuedCommand *_command = append(COMMAND_WRITE, _reg, _len, _callback, _context); 
+      if(_command == NULL)
+        return false; 
+      memcpy(_command->data, _buf, _len); 
+      return true; 
+    }
+
+    // Read-modify-write of one register: the bits under _mask are replaced
+    // by those of _bits. Nothing is written if they already match.
+    bool update(uint8_t _reg, uint8_t _mask, uint8_t _bits, commandCallback _callback = NULL, void *_context = NULL)
+    {
+      queuedCommand *_command = append(COMMAND_UPDATE, _reg, 1, _callback, _context); 
+      if(_command == NULL)
+        return false; 
+      _command->mask[0] = _mask; 
+      _command->data[0] = _bits & _mask; 
+      return true; 
+    }
+
+    // One register field, e.g. writeField<AS3935_NF_LEV>(3).
+    template <class Field>
+    bool writeField(uint8_t _value, commandCallback _callback = NULL, void *_context = NULL)
+    {
+      if(!Field::fits(_value))
+        return false; 
+      return update(Field::reg, Field::mask, Field::pack(_value), _callback, _context); 
+    }
+
+    // The whole configuration, checked like the driver's applyConfig(): one
+    // burst read of REG0x00 - REG0x08, then a write of each run of changed
+    // registers, so three transfers at most.
+    bool applyConfig(const AS3935Config &_config, commandCallback _callback = NULL, void *_context = NULL)
+    {
+      uint8_t _bits[SHADOW_REG_COUNT]; 
+      uint8_t _masks[SHADOW_REG_COUNT]; 
+      if(!Sensor::packConfig(_config, _bits, _masks))
+        return false; 
+      queuedCommand *_command = append(COMMAND_UPDATE, AFE_GAIN, COMMAND_MAX_BYTES, _callback, _context); 
+      if(_command == NULL)
+        return false; 
+      memcpy(_command->data, _bits, 4); 
+      memcpy(_command->mask, _masks, 4); 
+      _command->data[FREQ_DISP_IRQ] = _bits[4]; 
+      _command->mask[FREQ_DISP_IRQ] = _masks[4]; 
+      return true; 
+    }
+
+    // Moves the queue on without waiting. Returns the commands still queued,
+    // the running one included.
+    uint8_t service()
+    {
+      if(_running){
+        transferStatus _status = _detector->pollTransfer(); 
+        if(_status == TRANSFER_BUSY){
+          if( (_detector->transport().nowMicros() - _startMicros) > _timeout ){
+            _detector->abortTransfer(); 
+            _running = false; 
+            _timeouts++; 
+            finish(COMMAND_TIMEOUT); 
+          }
+          return _count; 
+        }
+        _running = false; 
+        if(_status == TRANSFER_TIMEOUT){
+          _timeouts++; 
+          finish(COMMAND_TIMEOUT); 
+        }
+        else if(_status != TRANSFER_DONE){
+          _busErrors++; 
+          finish(COMMAND_BUS_ERROR); 
+        }
+        else
+          transferDone(); 
+      }
+      if(_count > 0)
+        startTransfer(); 
+      return _count; 
+    }
+
+    // Commands queued, the running one included.
+    uint8_t pending() const { return _count; }
+
+    // Drops every command, aborting the running transfer. Each callback is
+    // called with COMMAND_CANCELLED.
+    void clear()
+    {
+      if(_running){
+        _detector->abortTransfer(); 
+        _running = false; 
+      }
+      while(_count > 0)
+        finish(COMMAND_CANCELLED); 
+    }
+
+    // Commands that ended with COMMAND_BUS_ERROR and COMMAND_TIMEOUT.
+    uint32_t busErrors() const { return _busErrors; }
+    uint32_t timeouts() const { return _timeouts; }
+
+  private:
+
+    enum { COMMAND_READ = 0, COMMAND_WRITE, COMMAND_UPDATE };
+    // Where the command at the head is.
+    enum { STAGE_NEW = 0, STAGE_READING, STAGE_WRITING, STAGE_MERGED };
+
+    struct queuedCommand {
+      uint8_t kind; 
+      uint8_t reg; 
+      uint8_t len; 
+      uint8_t data[COMMAND_MAX_BYTES]; // To write, or the new bits for update.
+      uint8_t mask[COMMAND_MAX_BYTES]; // Bits update replaces.
+      commandCallback callback; 
+      void *context; 
+    };
+
+    // Claims the next free slot, or returns NULL.
+    queuedCommand *append(uint8_t _kind, uint8_t _reg, uint8_t _len, commandCallback _callback, void *_context)
+    {
+      if( (_count >= N) || (_len == 0) || (_len > COMMAND_MAX_BYTES) )
+        return NULL; 
+      queuedCommand &_command = _commands[(_head + _count) % N]; 
+      memset(&_command, 0, sizeof(_command)); 
+      _command.kind = _kind; 
+      _command.reg = _reg; 
+      _command.len = _len; 
+      _command.callback = _callback; 
+      _command.context = _context; 
+      _count++; 
+      return &_command; 
+    }
+
+    // Starts the next transfer of the command at the head, if the transport
+    // takes it; otherwise the next service() tries again.
+    void startTransfer()
+    {
+      queuedCommand &_command = _commands[_head]; 
+      uint8_t _stageBefore = _stage; 
+      uint8_t _positionBefore = _position; 
+      bool _started; 
+      if(_stage == STAGE_NEW){
+        if(_command.kind == COMMAND_WRITE){
+          _started = _detector->startWrite(_command.reg, _command.data, _command.len); 
+          _stage = STAGE_WRITING; 
+        }
+        else {
+          _started = _detector->startRead(_command.reg, _current, _command.len); 
+          _stage = STAGE_READING; 
+        }
+      }
+      else {
+        // The next run of registers that the merge changed.
+        uint8_t _first = _position; 
+        while( (_first < _command.len) && (_command.data[_first] == _current[_first]) )
+          _first++; 
+        if(_first >= _command.len){
+          finish(COMMAND_OK); 
+          return; 
+        }
+        uint8_t _end = _first; 
+        while( (_end < _command.len) && (_command.data[_end] != _current[_end]) )
+          _end++; 
+        _started = _detector->startWrite(_command.reg + _first, &_command.data[_first], _end - _first); 
+        _position = _end; 
+        _stage = STAGE_WRITING; 
+      }
+      if(!_started){
+        _stage = _stageBefore; 
+        _position = _positionBefore; 
+        return; 
+      }
+      _running = true; 
+      _startMicros = _detector->transport().nowMicros(); 
+    }
+
+    // The transfer of the command at the head went through.
+    void transferDone()
+    {
+      queuedCommand &_command = _commands[_head]; 
+      if(_stage == STAGE_READING){
+        if(_command.kind == COMMAND_READ){
+          memcpy(_command.data, _current, _command.len); 
+          finish(COMMAND_OK); 
+          return; 
+        }
+        // The interrupt bits of REG0x03 are status, as in the driver, and the
+        // read just cleared them on the IC: the driver reports the interrupt.
+        if( (_command.reg <= INT_MASK_ANT) && (_command.reg + _command.len > INT_MASK_ANT) ){
+          _detector->keepInterrupt(_current[INT_MASK_ANT - _command.reg]); 
+          _current[INT_MASK_ANT - _command.reg] &= INT_MASK; 
+        }
+        for(uint8_t i = 0; i < _command.len; i++)
+          _command.data[i] = (_current[i] & ~_command.mask[i]) | _command.data[i]; 
+        _position = 0; 
+        _stage = STAGE_MERGED; 
+      }
+      else if(_command.kind == COMMAND_WRITE)
+        finish(COMMAND_OK); 
+      else
+        _stage = STAGE_MERGED; 
+    }
+
+    // Takes the command at the head off the queue and reports it.
+    void finish(commandResult _result)
+    {
+      queuedCommand _command = _commands[_head]; 
+      _head = (_head + 1) % N; 
+      _count--; 
+      _stage = STAGE_NEW; 
+      if(_command.callback != NULL)
+        _command.callback(_result, _command.reg, _command.data, _command.len, _command.context); 
+    }
+
+    Sensor *_detector; 
+    uint32_t _timeout; 
+    queuedCommand _commands[N]; 
+    uint8_t _head = 0; 
+    uint8_t _count = 0; 
+    uint8_t _stage = STAGE_NEW; 
+    uint8_t _position = 0;        // Update: first register not written yet.
+    uint8_t _current[COMMAND_MAX_BYTES]; // What the IC held, read by the head.
+    bool _running = false;        // A transfer is on the bus.
+    uint32_t _startMicros = 0;    // micros() when it started.
+    uint32_t _busErrors = 0; 
+    uint32_t _timeouts = 0; 
+
+};
+#endif
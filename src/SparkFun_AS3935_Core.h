@@ -0,0 +1,663 @@
+#ifndef _SPARKFUN_AS3935_CORE_H_
+#define _SPARKFUN_AS3935_CORE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include "SparkFun_AS3935_EventQueue.h"
+
+enum SF_AS3935_REGISTER_NAMES {
+
+	AFE_GAIN          = 0x00, 
+  THRESHOLD,
+  LIGHTNING_REG,
+  INT_MASK_ANT,
+  ENERGY_LIGHT_LSB,
+  ENERGY_LIGHT_MSB,
+  ENERGY_LIGHT_MMSB,
+  DISTANCE,
+  FREQ_DISP_IRQ,
+  CALIB_TRCO        = 0x3A, 
+  CALIB_SRCO        = 0x3B,
+  DEFAULT_RESET     = 0x3C,
+  CALIB_RCO         = 0x3D 
+
+};
+
+// Masks for various registers, there are some redundant values that I kept 
+// for the sake of clarity. Kept for existing sketches; the driver itself uses
+// the AS3935Field descriptors below, which also hold the shift.
+enum SF_AS3935_REGSTER_MASKS { 
+
+  GAIN_MASK         = 0xF,
+  SPIKE_MASK        = 0xF,
+  DISTANCE_MASK     = 0xC0,
+  INT_MASK          = 0xF0, 
+  ENERGY_MASK       = 0xF0, 
+  FLOOR_MASK        = 0x07,
+  OSC_MASK          = 0x07,
+  CAP_MASK          = 0x07, 
+  SPI_READ_M        = 0x40,
+  CALIB_MASK        = 0x7F,
+  CALIB_DONE_M      = 0x80, // REG0x3A/REG0x3B bit [7], calibration done.
+  CALIB_NOK_M       = 0x40  // REG0x3A/REG0x3B bit [6], calibration failed.
+
+};
+
+#define INDOOR  0x12
+#define OUTDOOR 0xE
+#define DIRECT_COMMAND 0x96
+
+// A field of a register: Width bits starting at bit Shift of register Reg.
+// The mask and packed values are constants the compiler folds, and a field
+// that does not fit its register, or a constant value that does not fit its
+// field, does not compile. 
+template <uint8_t Reg, uint8_t Shift, uint8_t Width>
+struct AS3935Field {
+
+  static_assert( (Width >= 1) && (Shift + Width <= 8), "A field has to fit in one register"); 
+
+  static constexpr uint8_t reg  = Reg; 
+  static constexpr uint8_t max  = (uint8_t)((1U << Width) - 1); 
+  static constexpr uint8_t mask = (uint8_t)(max << Shift); 
+
+  // True if _value fits the field. 
+  static constexpr bool fits(uint8_t _value) { return _value <= max; }
+  // _value moved into place, bits that do not fit dropped. 
+  static constexpr uint8_t pack(uint8_t _value) { return (uint8_t)((_value & max) << Shift); }
+  // The field's value out of a register value. 
+  static constexpr uint8_t unpack(uint8_t _regValue) { return (uint8_t)((_regValue & mask) >> Shift); }
+  // _regValue with the field replaced by _value. 
+  static constexpr uint8_t update(uint8_t _regValue, uint8_t _value)
+  {
+    return (uint8_t)((_regValue & ~mask) | pack(_value)); 
+  }
+  // pack() for a constant, checked when compiling. 
+  template <uint8_t Value>
+  static constexpr uint8_t packed()
+  {
+    static_assert(Value <= max, "Value does not fit the field"); 
+    return (uint8_t)(Value << Shift); 
+  }
+
+};
+
+template <uint8_t Reg, uint8_t Shift, uint8_t Width>
+constexpr uint8_t AS3935Field<Reg, Shift, Width>::reg; 
+template <uint8_t Reg, uint8_t Shift, uint8_t Width>
+constexpr uint8_t AS3935Field<Reg, Shift, Width>::max; 
+template <uint8_t Reg, uint8_t Shift, uint8_t Width>
+constexpr uint8_t AS3935Field<Reg, Shift, Width>::mask; 
+
+// The fields of the register map, named as in the datasheet. 
+typedef AS3935Field<AFE_GAIN, 0, 1>          AS3935_PWD;       // REG0x00 [0]
+typedef AS3935Field<AFE_GAIN, 1, 5>          AS3935_AFE_GB;    // REG0x00 [5:1]
+typedef AS3935Field<THRESHOLD, 0, 4>         AS3935_WDTH;      // REG0x01 [3:0]
+typedef AS3935Field<THRESHOLD, 4, 3>         AS3935_NF_LEV;    // REG0x01 [6:4]
+typedef AS3935Field<LIGHTNING_REG, 0, 4>     AS3935_SREJ;      // REG0x02 [3:0]
+typedef AS3935Field<LIGHTNING_REG, 4, 2>     AS3935_MIN_NUM;   // REG0x02 [5:4]
+typedef AS3935Field<LIGHTNING_REG, 6, 1>     AS3935_CL_STAT;   // REG0x02 [6]
+typedef AS3935Field<INT_MASK_ANT, 0, 4>      AS3935_INT;       // REG0x03 [3:0]
+typedef AS3935Field<INT_MASK_ANT, 5, 1>      AS3935_MASK_DIST; // REG0x03 [5]
+typedef AS3935Field<INT_MASK_ANT, 6, 2>      AS3935_LCO_FDIV;  // REG0x03 [7:6]
+typedef AS3935Field<ENERGY_LIGHT_MMSB, 0, 4> AS3935_S_LIG_MM;  // REG0x06 [3:0], energy [19:16]
+typedef AS3935Field<DISTANCE, 0, 6>          AS3935_DISTANCE;  // REG0x07 [5:0]
+typedef AS3935Field<FREQ_DISP_IRQ, 0, 4>     AS3935_TUN_CAP;   // REG0x08 [3:0]
+typedef AS3935Field<FREQ_DISP_IRQ, 5, 1>     AS3935_DISP_TRCO; // REG0x08 [5]
+typedef AS3935Field<FREQ_DISP_IRQ, 6, 1>     AS3935_DISP_SRCO; // REG0x08 [6]
+typedef AS3935Field<FREQ_DISP_IRQ, 7, 1>     AS3935_DISP_LCO;  // REG0x08 [7]
+
+typedef enum SF_AS3935_I2C_ADDRESS {
+
+ AS3935_DEFAULT_ADDRESS = 0x03, // Default ADD0 and ADD1 are HIGH
+ AS3935_ADDRESS_ADD1_H  = 0x02, // ADD1 HIGH, ADD0 LOW
+ AS3935_ADDRESS_ADD0_H  = 0x01, // ADD1 LOW, ADD0 HIGH
+ AS3935_ADDRESS_LOW     = 0x00  // BOTH LOW 
+
+} i2cAddress;
+
+typedef enum INTERRUPT_STATUS {
+
+  NOISE_TO_HIGH     = 0x01,
+  DISTURBER_DETECT  = 0x04,
+  LIGHTNING         = 0x08
+
+} lightningStatus;  
+
+// Every user setting of the IC, applied at once with applyConfig(). The
+// defaults are the manufacturer's. 
+struct AS3935Config {
+
+  uint8_t indoorOutdoor = INDOOR; // REG0x00 [5:1], INDOOR or OUTDOOR.
+  uint8_t noiseLevel    = 2;      // REG0x01 [6:4], 1 - 7.
+  uint8_t watchdog      = 2;      // REG0x01 [3:0], 1 - 10.
+  uint8_t spike         = 2;      // REG0x02 [3:0], 1 - 11.
+  uint8_t strikes       = 1;      // REG0x02 [5:4], 1, 5, 9 or 16.
+  bool    maskDisturber = false;  // REG0x03 [5].
+  uint8_t divisionRatio = 16;     // REG0x03 [7:6], 16, 32, 64 or 128.
+  uint8_t tuneCap       = 0;      // REG0x08 [3:0], 0 - 15.
+
+};
+
+// Counts the edges on the IRQ pin over _gateMs milliseconds and returns the
+// count, used by autoTuneAntenna(). _context is passed through untouched. 
+typedef uint32_t (*pulseCounter)(uint16_t _gateMs, void *_context);
+
+// The antenna should resonate at 500kHz, within 3.5 percent. 
+#define ANTENNA_TARGET_HZ 500000UL
+#define ANTENNA_TOLERANCE_PERMILLE 35
+
+// Result of autoTuneAntenna(). 
+typedef struct AS3935_TUNE_RESULT {
+
+  uint8_t  tuneCap;       // Best REG0x08 [3:0] value, 0 - 15.
+  uint32_t frequency;     // Measured LCO frequency in Hz at that value.
+  int16_t  errorPermille; // (frequency - 500kHz) in tenths of a percent.
+  bool     inSpec;        // Within +-3.5 percent of 500kHz. 
+  uint8_t  measurements;  // Number of gate periods it took. 
+
+} tuneResult;
+
+// Result of poll(), see notifyIrq(). 
+typedef enum SF_AS3935_POLL_STATUS {
+
+  POLL_IDLE         = 0, // No IRQ edge has been reported, or its read found
+                         // no interrupt. 
+  POLL_NOT_READY,        // IRQ edge seen, but the 2ms settling time has not passed. 
+  POLL_EVENT,            // The event was read inside its read window. 
+  POLL_LATE_EVENT,       // The event was read after its 1s (lightning) or 1.5s
+                         // (disturber) window, its data may be stale. 
+  POLL_BUS_ERROR         // Reading the event failed, the next poll() tries again.
+
+} pollStatus;
+
+// Result of the non-blocking startup and wake up, see startBegin(). 
+typedef enum SF_AS3935_STARTUP_RESULT {
+
+  STARTUP_PENDING   = 0, // Still running, keep calling step(). 
+  STARTUP_OK,            // Both oscillators calibrated successfully. 
+  STARTUP_NO_ACK,        // The IC did not acknowledge its I2C address. 
+  STARTUP_CALIB_FAIL,    // REG0x3A or REG0x3B reported a failed calibration. 
+  STARTUP_CALIB_TIMEOUT  // The calibration done bits never came up. 
+
+} startupResult;
+
+// Progress of a non-blocking transfer, see startRead(). 
+typedef enum SF_AS3935_TRANSFER_STATUS {
+
+  TRANSFER_IDLE     = 0, // Nothing started, or aborted. 
+  TRANSFER_BUSY,         // Still on the bus. 
+  TRANSFER_DONE,         // Finished, a read's data is in its buffer. 
+  TRANSFER_FAILED,       // Not acknowledged, or another bus error. 
+  TRANSFER_TIMEOUT       // A blocking transport gave up on a stuck bus. 
+
+} transferStatus;
+
+// Power up time (2ms LCO + 2ms RC oscillators), the time the TRCO is routed
+// to the IRQ pin during calibration and how long to wait for the done bits.
+// See "Timing" and "Clock Generation" in the datasheet. 
+#define POWER_UP_US     4000UL
+#define CALIB_RCO_US    2000UL
+#define CALIB_TIMEOUT_US 10000UL
+
+// Default bound on one register transfer, ten times a full REG0x00 - REG0x08
+// read at 100kHz: the command queue's timeout, the Wire timeout of
+// AS3935I2CTransport and the Linux I2C adapter timeout. 
+#define TRANSFER_TIMEOUT_US 10000UL
+
+// Microseconds the IC needs after the IRQ edge to populate REG0x03, and the
+// windows after which the lightning and disturber data are no longer held.
+// See "Interrupt Management" in the datasheet. 
+#define IRQ_SETTLE_US       2000UL
+#define LIGHTNING_WINDOW_US 1000000UL
+#define DISTURBER_WINDOW_US 1500000UL
+
+// A snapshot of everything the IC reports about a single event, decoded from
+// one burst read of REG0x03 through REG0x07. 
+typedef struct AS3935_EVENT {
+
+  uint8_t  interrupt; // REG0x03, bits [3:0], one of INTERRUPT_STATUS.
+  uint32_t energy;    // REG0x04 - REG0x06, 20 bit 'energy' of the strike.
+  uint8_t  distance;  // REG0x07, bits [5:0], distance to the storm in km.
+  uint32_t timestamp; // millis() at the IRQ edge (poll()) or at the read. 
+
+} lightningEvent;
+
+#ifdef AS3935_INSTRUMENTATION
+// Bus and timing counters, only compiled in when AS3935_INSTRUMENTATION is
+// defined for the whole build (a compiler flag, not a #define in one sketch
+// file, since it changes the size of the driver). 
+#define LATENCY_BUCKETS 12
+
+typedef struct AS3935_INSTRUMENTATION_SNAPSHOT {
+
+  uint32_t reads;          // Read transactions. 
+  uint32_t writes;         // Write transactions, direct commands included. 
+  uint32_t bytesRead;      // Register bytes received. 
+  uint32_t bytesWritten;   // Register bytes sent. 
+  uint32_t readErrors;     // Reads that returned fewer bytes than asked for. 
+  uint32_t writeErrors;    // Writes the transport reported as failed (NACK). 
+  uint32_t busMicros;      // Time spent inside the transport. 
+  uint32_t blockedMicros;  // Time spent in the blocking delays of begin(),
+                           // wakeUp(), readInterruptReg() and readEventSnapshot(),
+                           // never overlapping busMicros. 
+  uint32_t events;         // Events read by poll(). 
+  uint32_t maxLatencyMicros; // Longest IRQ edge to read time seen by poll(). 
+  // IRQ edge to read time of poll(), in powers of two: bucket 0 counts reads
+  // under 2048us, bucket n those under 2048us << n and the last bucket
+  // everything longer. 
+  uint32_t latency[LATENCY_BUCKETS]; 
+
+} instrumentationSnapshot;
+#endif
+
+// Everything saveState() keeps of the IC, plain bytes so it can be stored in
+// EEPROM or flash as is and checked with validState() when read back. 
+#define STATE_MAGIC 0x3935
+#define STATE_REG_COUNT 9 // REG0x00 - REG0x08
+
+typedef struct AS3935_STATE {
+
+  uint16_t magic;                 // STATE_MAGIC.
+  uint8_t  regs[STATE_REG_COUNT]; // REG0x00 - REG0x08 as read. 
+  uint8_t  calibration[2];        // REG0x3A and REG0x3B, TRCO and SRCO status.
+  uint8_t  checksum;              // CRC-8 of everything above. 
+
+} as3935State;
+
+// Number of configuration registers held in the shadow cache: REG0x00 -
+// REG0x03 and REG0x08.
+#define SHADOW_REG_COUNT 5
+
+// The driver itself. Everything that talks to the bus goes through the
+// Transport policy, so only the code for the bus actually in use is compiled
+// and no register access has to decide between I2C and SPI at run time. A
+// Transport provides:
+//
+//   void begin();      Sets up pins, no bus traffic. 
+//   bool probe();      True if the IC answers (always true where it can't tell). 
+//   uint8_t readRegisters(uint8_t reg, uint8_t *buf, uint8_t len); 
+//                      Burst read, returns the number of bytes read. 
+//   bool writeRegisters(uint8_t reg, const uint8_t *buf, uint8_t len); 
+//                      Burst write, returns false on a bus error. 
+//   uint32_t nowMicros(); uint32_t nowMillis(); void delayMs(uint16_t ms); 
+//   void disableIrq(); void enableIrq(); 
+//                      Timing and the critical section around data shared
+//                      with notifyIrq(). 
+//   void lockFromIrq(); void unlockFromIrq(); 
+//                      The same critical section entered from notifyIrq(),
+//                      i.e. from an ISR or a GPIO thread. Empty where an ISR
+//                      already runs with interrupts off. 
+//   void beginSession(); void endSession(); 
+//                      Hold the bus across transfers, nested calls count. 
+//                      Empty where the bus can not be held. 
+//
+// and, only for startRead() and the other non-blocking calls used by
+// AS3935CommandQueue: 
+//
+//   bool startRead(uint8_t reg, uint8_t *buf, uint8_t len); 
+//   bool startWrite(uint8_t reg, const uint8_t *buf, uint8_t len); 
+//                      Start one transfer, false while another is running.
+//                      buf has to stay valid until it is over. A transport
+//                      that runs the transfer right away bounds it itself
+//                      and reports TRANSFER_TIMEOUT when it gave up. 
+//   transferStatus pollTransfer(); void abortTransfer(); 
+//                      Its progress, which an interrupt driven bus may
+//                      complete from its ISR, and giving up on it. 
+//
+// AS3935I2CTransport and AS3935SPITransport (SparkFun_AS3935_Transport.h) are the
+// Arduino ones, SparkFun_AS3935_Linux.h has i2c-dev and spidev ones, and any
+// other class with these members works as well. 
+template <class Transport>
+class AS3935Driver
+{
+  public: 
+    explicit AS3935Driver(const Transport &_busTransport = Transport()) : _transport(_busTransport) { }
+    // The transport, to configure it before begin(). 
+    Transport &transport() { return _transport; }
+    // Holds the bus from beginSession() to the matching endSession(), so the
+    // calls in between skip the per transfer bus setup. AS3935BusSession
+    // does both for a scope. 
+    void beginSession() { _transport.beginSession(); }
+    void endSession() { _transport.endSession(); }
+    // Waits out the power up time and checks that the IC answers. 
+    bool begin();
+    // REG0x00, bit[0], manufacturer default: 0. 
+    // The product consumes 1-2uA while powered down. If the board is powered down 
+    // the the TRCO will need to be recalibrated: REG0x08[5] = 1, wait 2 ms, REG0x08[5] = 0.
+    // SPI and I-squared-C remain active when the chip is powered down. 
+    void powerDown();
+    // REG0x3A bit[7].
+    // This register holds the state of the timer RC oscillator (TRCO),
+    // after it has been calibrated. The TRCO will need to be recalibrated
+    // after power down. The following function wakes the IC, sends the "Direct Command" to 
+    // CALIB_RCO register REG0x3D, waits 2ms and then checks that it has been successfully
+    // calibrated. Note that I-squared-C and SPI are active during power down. 
+    bool wakeUp();
+    // Non-blocking versions of begin() and wakeUp(), so that several sensors
+    // can be brought up at the same time. Start one of them, then call step()
+    // until it returns true. startBegin() also calibrates the RC oscillators
+    // as the datasheet recommends after power up. Calibration is only
+    // reported as successful when both REG0x3A (TRCO) and REG0x3B (SRCO) have
+    // their done bit set and fail bit clear. While calibrating, the TRCO is
+    // routed to the IRQ pin for 2ms, so an ISR calling notifyIrq() fires on
+    // every cycle; step() drops those edges when it gives the pin back. 
+    void startBegin();
+    // The datasheet requires the TRCO to be recalibrated after a power down.
+    // So with _recalibrate false, startWakeUp() skips the calibration only if
+    // the IC has not been powered down since its last calibration and REG0x3A
+    // and REG0x3B still report a good one, e.g. when the microcontroller
+    // restarted while the AS3935 kept listening. It calibrates otherwise. 
+    void startWakeUp(bool _recalibrate = true);
+    // Advances the startup or wake up without blocking. Returns true once it
+    // has finished, successfully or not. 
+    bool step();
+    // True once the startup or wake up has finished successfully. 
+    bool isReady();
+    // STARTUP_PENDING while running, the outcome once finished. 
+    startupResult result();
+    // Milliseconds since the last successful calibration by startBegin(),
+    // wakeUp() or startWakeUp(), 0xFFFFFFFF if there has been none. 
+    uint32_t calibrationAge();
+    // REG0x00, bits [5:1], manufacturer default: 10010 (INDOOR). 
+    // This funciton changes toggles the chip's settings for Indoors and Outdoors. 
+    void setIndoorOutdoor(uint8_t _setting);
+    // REG0x01, bits[3:0], manufacturer default: 0010 (2). 
+    // This setting determines the threshold for events that trigger the 
+    // IRQ Pin.  
+    void watchdogThreshold(uint8_t _sensitivity);
+    // REG0x01, bits [6:4], manufacturer default: 010 (2).
+    // The noise floor level is compared to a known reference voltage. If this
+    // level is exceeded the chip will issue an interrupt to the IRQ pin,
+    // broadcasting that it can not operate properly due to noise (INT_NH).
+    // Check datasheet for specific noise level tolerances when setting this register. 
+    void setNoiseLevel(uint8_t _floor);
+    // REG0x02, bits [3:0], manufacturer default: 0010 (2).
+    // This setting, like the watchdog threshold, can help determine between false
+    // events and actual lightning. The shape of the spike is analyzed during the
+    // chip's signal validation routine. Increasing this value increases robustness
+    // at the cost of sensitivity to distant events. 
+    void spikeRejection(uint8_t _spSensitivity);
+    // REG0x02, bits [5:4], manufacturer default: 0 (single lightning strike).
+    // The number of lightning events before IRQ is set high. 15 minutes is The 
+    // window of time before the number of detected lightning events is reset. 
+    // The number of lightning strikes can be set to 1,5,9, or 16. 
+    void lightningThreshold(uint8_t _strikes);
+    // REG0x02, bit [6], manufacturer default: 1. 
+    // This register clears the number of lightning strikes that has been read in
+    // the last 15 minute block. 
+    void clearStatistics(bool _clearStat);
+    // REG0x03, bits [3:0], manufacturer default: 0. 
+    // When there is an event that exceeds the watchdog threshold, the register is written
+    // with the type of event. This consists of two messages: INT_D (disturber detected) and 
+    // INT_L (Lightning detected). A third interrupt INT_NH (noise level too HIGH) 
+    // indicates that the noise level has been exceeded and will persist until the
+    // noise has ended. Events are active HIGH. There is a one second window of time to
+    // read the interrupt register after lightning is detected, and 1.5 after
+    // disturber. An interrupt found earlier by a configuration read, see
+    // keepInterrupt(), is returned if the register holds none. 
+    uint8_t readInterruptReg();
+    // REG0x03, bit [5], manufacturere default: 0.
+    // This setting will change whether or not disturbers trigger the IRQ Pin. 
+    void maskDisturber(bool _state);
+    // REG0x03, bit [7:6], manufacturer default: 0 (16 division ratio). 
+    // The antenna is designed to resonate at 500kHz and so can be tuned with the
+    // following setting. The accuracy of the antenna must be within 3.5 percent of
+    // that value for proper signal validation and distance estimation.
+    void antennaTuning(uint8_t _divisionRatio);
+    // REG0x07, bit [5:0], manufacturer default: 0. 
+    // This register holds the distance to the front of the storm and not the
+    // distance to a lightning strike.  
+    uint8_t distanceToStorm();
+    // REG0x08, bits [5,6,7], manufacturer default: 0. 
+    // This will send the frequency of the oscillators to the IRQ pin. 
+    //  _osc 1, bit[5] = TRCO - Timer RCO Oscillators 1.1MHz
+    //  _osc 2, bit[6] = SRCO - System RCO at 32.768kHz
+    //  _osc 3, bit[7] = LCO - Frequency of the Antenna
+    void displayOscillator(bool _state, uint8_t _osc);
+    // REG0x08, bits [3:0], manufacturer default: 0. 
+    // This setting will add capacitance to the series RLC antenna on the product.
+    // It's possible to add 0-120pF in steps of 8pF to the antenna. 
+    void tuneCap(uint8_t _farad);
+    // LSB =  REG0x04, bits[7:0]
+    // MSB =  REG0x05, bits[7:0]
+    // MMSB = REG0x06, bits[4:0]
+    // This returns a 20 bit value that is the 'energy' of the lightning strike.
+    // According to the datasheet this is only a pure value that doesn't have any
+    // physical meaning. 
+    uint32_t lightningEnergy();
+    // REG0x03 - REG0x07
+    // Reads the interrupt, energy and distance registers in a single bus
+    // transaction and decodes them into the given event. Because the registers
+    // are read together the energy bytes can not change between reads. Like
+    // readInterruptReg(), this waits 2ms for the registers to be populated.
+    // Returns false if the IC did not return every byte. 
+    bool readEventSnapshot(lightningEvent &_event);
+    // Non-blocking alternative to readInterruptReg() and readEventSnapshot(). 
+    // Call notifyIrq() from the interrupt service routine attached to the IRQ
+    // pin (rising edge); it only stores a timestamp and is safe to call from
+    // an ISR. Then call poll() from the loop: it returns POLL_NOT_READY until
+    // 2ms have passed since the edge, and then reads the event in one burst.
+    // If the read happens after the event's read window POLL_LATE_EVENT is
+    // returned instead of POLL_EVENT. If the read fails POLL_BUS_ERROR is
+    // returned and the edge stays pending, so the next poll() reads again.
+    // An edge whose read finds REG0x03 empty returns POLL_IDLE. 
+    void notifyIrq();
+    pollStatus poll(lightningEvent &_event);
+    // True if notifyIrq() reported an edge, or keepInterrupt() an interrupt,
+    // that poll() has not read yet. 
+    bool irqPending();
+    // Microseconds since the edge reported by notifyIrq(). 
+    uint32_t irqAge();
+    // REG0x03, bits [3:0]
+    // Reading REG0x03 clears the interrupt and lowers IRQ, and REG0x03 is also
+    // a configuration register. So when a read for the configuration (the
+    // setters, readConfig(), applyConfig(), saveState(), restoreState() and
+    // the shadow cache) finds an interrupt, the driver keeps it: irqPending()
+    // turns true, and the next poll(), readInterruptReg() or
+    // readEventSnapshot() returns it with the energy and distance still in
+    // REG0x04 - REG0x07. If a newer interrupt is read first, that one is
+    // returned and the kept one stays pending for the read after it, with
+    // the newer event's energy and distance. Code that reads REG0x03 on its
+    // own, such as AS3935CommandQueue, hands the register over with this
+    // function. 
+    void keepInterrupt(uint8_t _intReg);
+    // Same as above, but a successfully read event is pushed as a compact
+    // record onto the given queue, which the application drains at its own
+    // pace. When the queue is full the event is dropped and counted by the
+    // queue's overflowCount(). 
+    template <uint8_t N>
+    pollStatus poll(AS3935EventQueue<N> &_queue)
+    {
+      lightningEvent _event; 
+      pollStatus _status = poll(_event); 
+      if( (_status == POLL_EVENT) || (_status == POLL_LATE_EVENT) )
+        _queue.push(AS3935EventRecord::fromEvent(_event, _status == POLL_LATE_EVENT)); 
+      return _status; 
+    }
+    // REG0x3C
+    // Sends the "Direct Command" to the DEFAULT_RESET register which sets all
+    // registers back to their manufacturer defaults. 
+    void resetSettings();
+    // When enabled, the library keeps a write-through copy of the configuration
+    // registers REG0x00 - REG0x03 and REG0x08. Setters then only need a single
+    // write instead of a read-modify-write, and the read functions below are
+    // answered without touching the bus. The copy is filled in begin()
+    // (or right away if already started), and is dropped after
+    // resetSettings() or powerDown() and read again on the next write. 
+    void useShadowRegisters(bool _state);
+    // Reads the configuration registers from the IC into the shadow cache.
+    // Returns false if the IC did not return every byte.
+    bool syncShadowRegisters();
+    // Compares the shadow cache against the IC without changing either.
+    // Returns true if every configuration register matches. 
+    bool verifyShadowRegisters();
+    // REG0x00, bits [5:1]. Returns INDOOR or OUTDOOR (or the raw setting). 
+    uint8_t readIndoorOutdoor();
+    // REG0x01, bits[3:0]. 
+    uint8_t readWatchdogThreshold();
+    // REG0x01, bits [6:4].
+    uint8_t readNoiseLevel();
+    // REG0x02, bits [3:0].
+    uint8_t readSpikeRejection();
+    // REG0x02, bits [5:4]. Returns 1, 5, 9 or 16 lightning strikes. 
+    uint8_t readLightningThreshold();
+    // REG0x03, bit [5]. 
+    bool readMaskDisturber();
+    // REG0x03, bit [7:6]. Returns a division ratio of 16, 32, 64 or 128.
+    uint8_t readAntennaTuning();
+    // REG0x08, bits [3:0]. 
+    uint8_t readTuneCap();
+    // Finds the tuning capacitor value that brings the antenna closest to
+    // 500kHz. The LCO is routed to the IRQ pin divided by _divisionRatio and
+    // the given counter measures it for _gateMs per step. Since the frequency
+    // falls as capacitance is added, a binary search over the 16 values plus
+    // one neighbour check needs 4 to 6 gate periods instead of 16. The best
+    // value is left in REG0x08, the division ratio is restored and the IRQ
+    // pin is given back to interrupts; edges notifyIrq() saw meanwhile are
+    // dropped. Returns true if within 3.5 percent. 
+    bool autoTuneAntenna(pulseCounter _counter, void *_context, tuneResult &_result, uint16_t _gateMs = 100, uint8_t _divisionRatio = 128);
+    // Reads every setting of AS3935Config from the IC (or the shadow cache). 
+    bool readConfig(AS3935Config &_config);
+    // Validates the whole configuration and then writes it with as few bus
+    // transactions as possible: fields sharing a register are packed into one
+    // byte, unchanged registers are skipped and REG0x00 - REG0x03 go out in a
+    // single burst. If any field is out of range nothing is written and false
+    // is returned; false is also returned after a bus error. 
+    bool applyConfig(const AS3935Config &_config);
+    // Reads REG0x00 - REG0x08 and the calibration status in two bursts.
+    // Returns false if the IC did not return every byte. 
+    bool saveState(as3935State &_state);
+    // Reads REG0x00 - REG0x08 in one burst and writes back only what differs
+    // from _state: one burst over the changed part of REG0x00 - REG0x03 and
+    // REG0x08 if it changed, so three transactions at most. The read only
+    // registers are left alone, and so is the calibration: after a power on
+    // reset startWakeUp() or wakeUp() has to run as well, which the saved
+    // calibration status can be compared against. Returns false for a state
+    // that fails validState() or a bus error. 
+    bool restoreState(const as3935State &_state);
+    // True if _state has the magic number and a matching checksum. 
+    static bool validState(const as3935State &_state);
+    // Checks every field of _config like applyConfig() and packs them into
+    // the bits and masks of REG0x00 - REG0x03 and REG0x08, in shadow cache
+    // order. Returns false, with nothing filled in, if a field is out of range.
+    static bool packConfig(const AS3935Config &_config, uint8_t *_bits, uint8_t *_masks);
+    // Non-blocking register access, the basis of AS3935CommandQueue. One
+    // transfer runs at a time: start it, then call pollTransfer() until it
+    // is no longer TRANSFER_BUSY, or give up with abortTransfer(). Both start
+    // calls return false if the transport could not start. A write drops the
+    // shadow cache if it touches a cached register or DEFAULT_RESET, it is
+    // read again on its next use. 
+    bool startRead(uint8_t _reg, uint8_t *_buf, uint8_t _len);
+    bool startWrite(uint8_t _reg, const uint8_t *_buf, uint8_t _len);
+    transferStatus pollTransfer();
+    void abortTransfer();
+#ifdef AS3935_INSTRUMENTATION
+    // Copies the bus and timing counters. Everything counts from construction
+    // or the last clearInstrumentation(). 
+    void readInstrumentation(instrumentationSnapshot &_snapshot);
+    void clearInstrumentation();
+#endif
+  
+  private:
+
+    Transport _transport; 
+    // Write-through copy of REG0x00 - REG0x03 and REG0x08. 
+    uint8_t _shadowReg[SHADOW_REG_COUNT]; 
+    bool _shadowEnabled = false; // User wants the shadow cache. 
+    bool _shadowValid = false; // The shadow cache matches the IC. 
+    bool _started = false; // begin() or step() got an answer from the IC. 
+    uint8_t _startupState = 0; // Current step of the startup state machine. 
+    startupResult _startupResult = STARTUP_PENDING; 
+    uint32_t _startupMicros = 0; // micros() when the current step began. 
+    bool _calibrated = false; // A calibration has succeeded, see calibrationAge().
+    uint32_t _calibrationMillis = 0; // millis() at the last good calibration. 
+    bool _poweredDown = false; // powerDown() since the last good calibration. 
+    volatile bool _irqPending = false; // Set by notifyIrq(), cleared by poll(). 
+    volatile uint32_t _irqMicros = 0; // micros() at the last IRQ edge. 
+    uint8_t _keptInterrupt = 0; // Found by a configuration read, see keepInterrupt().
+#ifdef AS3935_INSTRUMENTATION
+    instrumentationSnapshot _stats = instrumentationSnapshot(); 
+    bool _transferWrite = false; // The running non-blocking transfer. 
+    uint8_t _transferLen = 0; 
+    // Adds one IRQ edge to read time to the histogram. 
+    void recordLatency(uint32_t _micros);
+#endif
+    // Blocking wait, the only place the driver calls delayMs(). 
+    void blockingDelay(uint16_t _ms);
+    // This function handles all write commands. It reads the register,
+    // replaces the bits under _mask with the already shifted _packed bits and
+    // writes it back. 
+    void writeRegister(uint8_t _reg, uint8_t _mask, uint8_t _packed);
+    // Writes one field, the register is read first. The constant version
+    // rejects values that do not fit when compiling. 
+    template <class Field> void writeField(uint8_t _value) { writeRegister(Field::reg, Field::mask, Field::pack(_value)); }
+    template <class Field, uint8_t Value> void writeField() { writeRegister(Field::reg, Field::mask, Field::template packed<Value>()); }
+    // Reads one configuration field, from the shadow cache when it is valid. 
+    template <class Field> uint8_t readField() { return Field::unpack(readConfigRegister(Field::reg)); }
+    // This function reads the given register. 
+    uint8_t readRegister(uint8_t _reg);
+    // This function reads _len consecutive registers starting at _reg into
+    // _buf using a single bus transaction. Returns the number of bytes read. 
+    uint8_t readRegisters(uint8_t _reg, uint8_t *_buf, uint8_t _len);
+    // This function writes _len consecutive registers starting at _reg from
+    // _buf as is, without reading them first. 
+    bool writeRegisters(uint8_t _reg, const uint8_t *_buf, uint8_t _len);
+    // Sends the "Direct Command" to REG0x3C or REG0x3D. 
+    void sendDirectCommand(uint8_t _reg);
+    // Sends CALIB_RCO and routes the TRCO to the IRQ pin, the first half of
+    // the datasheet's RCO calibration. 
+    void startCalibration();
+    // Reads REG0x3A and REG0x3B. Returns STARTUP_OK or STARTUP_CALIB_FAIL
+    // once both are done, STARTUP_PENDING before that. 
+    startupResult calibrationStatus();
+    // Decodes the 20 bit lightning energy from the LSB, MSB and MMSB bytes. 
+    uint32_t decodeEnergy(const uint8_t *_energyBytes);
+    // Burst reads REG0x03 - REG0x07 into the event without any settling delay.
+    bool readEventRegisters(lightningEvent &_event);
+    // The interrupt read from REG0x03, or else the kept one, which is used up. 
+    uint8_t takeInterrupt(uint8_t _interrupt);
+    // Sets the tuning capacitor and measures the resulting LCO frequency. 
+    uint32_t measureAntenna(uint8_t _cap, pulseCounter _counter, void *_context, uint16_t _gateMs, uint8_t _divisionRatio);
+    // CRC-8 (polynomial 0x31) of the saved state, without its checksum. 
+    static uint8_t stateChecksum(const as3935State &_state);
+    // Reads the five configuration registers, in shadow cache order. 
+    bool readConfigBlock(uint8_t *_regs);
+    // Returns the shadow cache index of a configuration register, or -1 if the
+    // register is not cached. 
+    int8_t shadowIndex(uint8_t _reg);
+    // Reads a configuration register, from the shadow cache when it is valid. 
+    uint8_t readConfigRegister(uint8_t _reg);
+
+};
+
+// Holds the bus of a sensor for the scope it lives in:
+//
+//   {
+//     AS3935BusSession<SparkFun_AS3935> _session(lightning); 
+//     lightning.setNoiseLevel(3); 
+//     lightning.spikeRejection(4); 
+//   } // Bus released here. 
+//
+// Over SPI the scope is one SPI transaction, over I2C one run of repeated
+// STARTs ended by a single STOP; any driver call may be made inside. Other
+// devices on the bus wait until the scope ends, and blocking calls such as
+// begin() or wakeUp() keep them waiting through their delays, so keep the
+// scope short. Sessions nest. 
+template <class Sensor>
+class AS3935BusSession
+{
+  public:
+    explicit AS3935BusSession(Sensor &_sensor) : _held(&_sensor) { _held->beginSession(); }
+    ~AS3935BusSession() { _held->endSession(); }
+
+  private:
+    AS3935BusSession(const AS3935BusSession &); 
+    AS3935BusSession &operator=(const AS3935BusSession &); 
+
+    Sensor *_held; 
+};
+
+#include "SparkFun_AS3935_Core_impl.h"
+#endif
@@ -0,0 +1,1165 @@
+// Member definitions of AS3935Driver, included at the end of
+// SparkFun_AS3935_Core.h. 
+
+#ifndef _SPARKFUN_AS3935_CORE_IMPL_H_
+#define _SPARKFUN_AS3935_CORE_IMPL_H_
+
+// This function takes care of the power up time and checks that the IC
+// answers. 
+template <class Transport>
+bool AS3935Driver<Transport>::begin()
+{
+  // Startup time requires 2ms for the LCO and 2ms more for the RC oscillators
+  // which occurs only after the LCO settles. See "Timing" under "Electrical
+  // Characteristics" in the datasheet.  
+  blockingDelay(4); 
+  _transport.begin(); 
+  if(!_transport.probe())
+    return false; 
+
+  _started = true; 
+  if(_shadowEnabled)
+    return syncShadowRegisters(); 
+  return true;
+}
+
+// REG0x00, bit[0], manufacturer default: 0. 
+// The product consumes 1-2uA while powered down. If the board is powered down 
+// the the TRCO will need to be recalibrated: REG0x08[5] = 1, wait 2 ms, REG0x08[5] = 0.
+// SPI and I-squared-C remain active when the chip is powered down. 
+template <class Transport>
+void AS3935Driver<Transport>::powerDown()
+{
+  writeField<AS3935_PWD, 1>(); 
+  _shadowValid = false; // Re-read on the next write after waking. 
+  _poweredDown = true; // The calibration is lost. 
+}
+
+// REG0x3A bit[7].
+// This register holds the state of the timer RC oscillator (TRCO),
+// after it has been calibrated. The TRCO in this case needs to be recalibrated
+// after power down. The following function wakes the IC, sends the "Direct Command" to 
+// CALIB_RCO register REG0x3D, waits 2ms and then checks that it has been successfully
+// calibrated. Note that I-squared-C and SPI are active during power down. 
+template <class Transport>
+bool AS3935Driver<Transport>::wakeUp()
+{
+#ifdef AS3935_INSTRUMENTATION
+  uint32_t _start = _transport.nowMicros(); 
+  uint32_t _busBefore = _stats.busMicros; 
+#endif
+  startWakeUp(); 
+  while(!step()) ; // Same 2ms as before, but spent checking the done bits. 
+#ifdef AS3935_INSTRUMENTATION
+  // Only the waiting counts, the transfers in between are in busMicros. 
+  _stats.blockedMicros += (_transport.nowMicros() - _start) - (_stats.busMicros - _busBefore); 
+#endif
+  return isReady(); 
+}
+
+// Non-blocking begin(). The power up time is waited out in step(), followed
+// by the RC oscillator calibration. 
+template <class Transport>
+void AS3935Driver<Transport>::startBegin()
+{
+  _transport.begin(); 
+  _started = false; 
+  _startupResult = STARTUP_PENDING; 
+  _startupState = 1; // Waiting for the oscillators to power up. 
+  _startupMicros = _transport.nowMicros(); 
+}
+
+// Non-blocking wakeUp(). Clears the power down bit and starts calibrating,
+// or with _recalibrate false and an IC that stayed powered first checks
+// whether it still reports a good calibration. 
+template <class Transport>
+void AS3935Driver<Transport>::startWakeUp(bool _recalibrate)
+{
+  // REG0x3A/REG0x3B may still show the calibration from before a power
+  // down, whether by powerDown() or by another program, but it is lost. 
+  if(!_recalibrate && (_poweredDown || readField<AS3935_PWD>()))
+    _recalibrate = true; 
+  writeField<AS3935_PWD, 0>(); // Set the power down bit to zero to wake it up
+  _startupResult = STARTUP_PENDING; 
+  _startupMicros = _transport.nowMicros(); 
+  if(!_recalibrate){
+    _startupState = 4; // Checking the done bits. 
+    return; 
+  }
+  startCalibration(); 
+  _startupState = 2; // Waiting for the TRCO calibration. 
+}
+
+// States: 0 idle, 1 power up, 2 TRCO routed to IRQ, 3 waiting for done bits,
+// 4 checking whether a calibration is still good.
+template <class Transport>
+bool AS3935Driver<Transport>::step()
+{
+  uint32_t _elapsed = _transport.nowMicros() - _startupMicros; 
+
+  switch(_startupState){
+    case 1:
+      if(_elapsed < POWER_UP_US)
+        return false; 
+      if(!_transport.probe()){
+        _startupResult = STARTUP_NO_ACK; 
+        _startupState = 0; 
+        return true; 
+      }
+      _started = true; 
+      startCalibration(); 
+      _startupState = 2; 
+      _startupMicros = _transport.nowMicros(); 
+      return false; 
+
+    case 2:
+      if(_elapsed < CALIB_RCO_US)
+        return false; 
+      writeField<AS3935_DISP_TRCO, 0>(); // Stop displaying the TRCO.
+      // The 1.1MHz on the IRQ pin was no event, forget its edges. 
+      _transport.disableIrq(); 
+      _irqPending = false; 
+      _transport.enableIrq(); 
+      _startupState = 3; 
+      _startupMicros = _transport.nowMicros(); 
+      return false; 
+
+    case 3:
+      _startupResult = calibrationStatus(); 
+      if( (_startupResult == STARTUP_PENDING) && (_elapsed > CALIB_TIMEOUT_US) )
+        _startupResult = STARTUP_CALIB_TIMEOUT; 
+      if(_startupResult == STARTUP_PENDING)
+        return false; 
+      if(_startupResult == STARTUP_OK){
+        _calibrationMillis = _transport.nowMillis(); 
+        _calibrated = true; 
+        _poweredDown = false; 
+      }
+      if( (_startupResult == STARTUP_OK) && _shadowEnabled && !_shadowValid )
+        syncShadowRegisters(); 
+      _startupState = 0; 
+      return true; 
+
+    case 4:
+      // Good: done. Anything else: calibrate after all. 
+      if(calibrationStatus() != STARTUP_OK){
+        startCalibration(); 
+        _startupState = 2; 
+        _startupMicros = _transport.nowMicros(); 
+        return false; 
+      }
+      _startupResult = STARTUP_OK; 
+      _started = true; // It answered, e.g. after a restart of the program. 
+      if(_shadowEnabled && !_shadowValid)
+        syncShadowRegisters(); 
+      _startupState = 0; 
+      return true; 
+
+    default:
+      return true; 
+  }
+}
+
+// True once the startup or wake up has finished successfully. 
+template <class Transport>
+bool AS3935Driver<Transport>::isReady()
+{
+  return (_startupResult == STARTUP_OK); 
+}
+
+// STARTUP_PENDING while running, the outcome once finished. 
+template <class Transport>
+startupResult AS3935Driver<Transport>::result()
+{
+  return _startupResult; 
+}
+
+// Milliseconds since the last successful RC oscillator calibration. 
+template <class Transport>
+uint32_t AS3935Driver<Transport>::calibrationAge()
+{
+  if(!_calibrated)
+    return 0xFFFFFFFF; 
+  return _transport.nowMillis() - _calibrationMillis; 
+}
+
+// REG0x3D
+// Calibrating the RC oscillators: send the "Direct Command" to CALIB_RCO, then
+// REG0x08[5] = 1, wait 2 ms, REG0x08[5] = 0. This does the first half. 
+template <class Transport>
+void AS3935Driver<Transport>::startCalibration()
+{
+  sendDirectCommand(CALIB_RCO); 
+  writeField<AS3935_DISP_TRCO, 1>(); // Display the TRCO on the IRQ pin.
+}
+
+// REG0x3A bits [7:6] for the TRCO and REG0x3B bits [7:6] for the SRCO.
+// Bit 7 is set when the calibration is done and bit 6 when it failed. 
+template <class Transport>
+startupResult AS3935Driver<Transport>::calibrationStatus()
+{
+  uint8_t _calib[2]; 
+  if(readRegisters(CALIB_TRCO, _calib, 2) != 2)
+    return STARTUP_PENDING; 
+  if( (_calib[0] & CALIB_NOK_M) || (_calib[1] & CALIB_NOK_M) )
+    return STARTUP_CALIB_FAIL; 
+  if( (_calib[0] & CALIB_DONE_M) && (_calib[1] & CALIB_DONE_M) )
+    return STARTUP_OK; 
+  return STARTUP_PENDING; 
+}
+
+// REG0x00, bits [5:1], manufacturer default: 10010 (INDOOR). 
+// This funciton changes toggles the chip's settings for Indoors and Outdoors. 
+template <class Transport>
+void AS3935Driver<Transport>::setIndoorOutdoor( uint8_t _setting )
+{
+  if( (_setting != INDOOR) && (_setting != OUTDOOR) )
+    return;
+
+  writeField<AS3935_AFE_GB>(_setting); 
+}
+
+// REG0x01, bits[3:0], manufacturer default: 0010 (2). 
+// This setting determines the threshold for events that trigger the 
+// IRQ Pin.  
+template <class Transport>
+void AS3935Driver<Transport>::watchdogThreshold( uint8_t _sensitivity )
+{
+  if( (_sensitivity < 1) | (_sensitivity > 10) )// 10 is the max sensitivity setting
+    return; 
+
+  writeField<AS3935_WDTH>(_sensitivity); 
+}
+
+// REG0x01, bits [6:4], manufacturer default: 010 (2).
+// The noise floor level is compared to a known reference voltage. If this
+// level is exceeded the chip will issue an interrupt to the IRQ pin,
+// broadcasting that it can not operate properly due to noise (INT_NH).
+// Check datasheet for specific noise level tolerances when setting this register. 
+template <class Transport>
+void AS3935Driver<Transport>::setNoiseLevel( uint8_t _floor )
+{
+  if( (_floor < 1) | (_floor > 7) )
+    return; 
+  
+  writeField<AS3935_NF_LEV>(_floor); 
+}
+
+// REG0x02, bits [3:0], manufacturer default: 0010 (2).
+// This setting, like the watchdog threshold, can help determine between false
+// events and actual lightning. The shape of the spike is analyzed during the
+// chip's signal validation routine. Increasing this value increases robustness
+// at the cost of sensitivity to distant events. 
+template <class Transport>
+void AS3935Driver<Transport>::spikeRejection( uint8_t _spSensitivity )
+{
+  if( (_spSensitivity < 1) | (_spSensitivity > 11) )
+    return; 
+
+  writeField<AS3935_SREJ>(_spSensitivity); 
+}
+
+
+// REG0x02, bits [5:4], manufacturer default: 0 (single lightning strike).
+// The number of lightning events before IRQ is set high. 15 minutes is The 
+// window of time before the number of detected lightning events is reset. 
+// The number of lightning strikes can be set to 1,5,9, or 16. 
+template <class Transport>
+void AS3935Driver<Transport>::lightningThreshold( uint8_t _strikes )
+{
+  switch(_strikes){
+    case 1:  writeField<AS3935_MIN_NUM, 0>(); break; 
+    case 5:  writeField<AS3935_MIN_NUM, 1>(); break; 
+    case 9:  writeField<AS3935_MIN_NUM, 2>(); break; 
+    case 16: writeField<AS3935_MIN_NUM, 3>(); break; 
+    default: return; 
+  }
+}
+
+
+// REG0x02, bit [6], manufacturer default: 1. 
+// This register clears the number of lightning strikes that has been read in
+// the last 15 minute block. 
+template <class Transport>
+void AS3935Driver<Transport>::clearStatistics(bool _clearStat)
+{
+  if(_clearStat != true)
+    return;
+  //Write high, then low, then high to clear.
+  writeField<AS3935_CL_STAT, 1>();
+  writeField<AS3935_CL_STAT, 0>();
+  writeField<AS3935_CL_STAT, 1>();
+}
+
+// REG0x03, bits [3:0], manufacturer default: 0. 
+// When there is an event that exceeds the watchdog threshold, the register is written
+// with the type of event. This consists of two messages: INT_D (disturber detected) and 
+// INT_L (Lightning detected). A third interrupt INT_NH (noise level too HIGH) 
+// indicates that the noise level has been exceeded and will persist until the
+// noise has ended. Events are active HIGH. There is a one second window of time to
+// read the interrupt register after lightning is detected, and 1.5 after
+// disturber.  
+template <class Transport>
+uint8_t AS3935Driver<Transport>::readInterruptReg()
+{
+    // A 2ms delay is added to allow for the memory register to be populated 
+    // after the interrupt pin goes HIGH. See "Interrupt Management" in
+    // datasheet. 
+    blockingDelay(2);
+    return takeInterrupt(AS3935_INT::unpack(readRegister(AS3935_INT::reg))); // Only need the first four bits [3:0]
+}
+
+// REG0x03, bit [5], manufacturere default: 0.
+// This setting will change whether or not disturbers trigger the IRQ Pin. 
+template <class Transport>
+void AS3935Driver<Transport>::maskDisturber(bool _state)
+{
+  writeField<AS3935_MASK_DIST>(_state); 
+}
+
+// REG0x03, bit [7:6], manufacturer default: 0 (16 division ratio). 
+// The antenna is designed to resonate at 500kHz and so can be tuned with the
+// following setting. The accuracy of the antenna must be within 3.5 percent of
+// that value for proper signal validation and distance estimation.
+template <class Transport>
+void AS3935Driver<Transport>::antennaTuning(uint8_t _divisionRatio)
+{
+  switch(_divisionRatio){
+    case 16:  writeField<AS3935_LCO_FDIV, 0>(); break; 
+    case 32:  writeField<AS3935_LCO_FDIV, 1>(); break; 
+    case 64:  writeField<AS3935_LCO_FDIV, 2>(); break; 
+    case 128: writeField<AS3935_LCO_FDIV, 3>(); break; 
+    default: return; 
+  }
+}
+// REG0x07, bit [5:0], manufacturer default: 0. 
+// This register holds the distance to the front of the storm and not the
+// distance to a lightning strike.  
+template <class Transport>
+uint8_t AS3935Driver<Transport>::distanceToStorm()
+{
+  return AS3935_DISTANCE::unpack(readRegister(AS3935_DISTANCE::reg)); 
+}
+// REG0x08, bits [5,6,7], manufacturer default: 0. 
+// This will send the frequency of the oscillators to the IRQ pin. 
+//  _osc 1, bit[5] = TRCO - Timer RCO Oscillators 1.1MHz
+//  _osc 2, bit[6] = SRCO - System RCO at 32.768kHz
+//  _osc 3, bit[7] = LCO - Frequency of the Antenna
+template <class Transport>
+void AS3935Driver<Transport>::displayOscillator(bool _state, uint8_t _osc)
+{
+  if( (_osc < 1) | (_osc > 3) )
+    return;
+
+  if(_osc == 1)
+    writeField<AS3935_DISP_TRCO>(_state); 
+  if(_osc == 2)
+    writeField<AS3935_DISP_SRCO>(_state); 
+  if(_osc == 3)
+    writeField<AS3935_DISP_LCO>(_state); 
+}
+// REG0x08, bits [3:0], manufacturer default: 0. 
+// This setting will add capacitance to the series RLC antenna on the product
+// to help tune its resonance. The datasheet specifies being within 3.5 percent
+// of 500kHz to get optimal lightning detection and distance sensing.  
+// It's possible to add up to 120pF in steps of 8pF to the antenna. 
+template <class Transport>
+void AS3935Driver<Transport>::tuneCap(uint8_t _farad)
+{
+  if(_farad > 15)
+   return;
+
+  writeField<AS3935_TUN_CAP>(_farad); 
+}
+
+// LSB =  REG0x04, bits[7:0]
+// MSB =  REG0x05, bits[7:0]
+// MMSB = REG0x06, bits[4:0]
+// This returns a 20 bit value that is the 'energy' of the lightning strike.
+// According to the datasheet this is only a pure value that doesn't have any
+// physical meaning. 
+template <class Transport>
+uint32_t AS3935Driver<Transport>::lightningEnergy()
+{
+  uint8_t _energyBytes[3] = { 0 }; 
+  // One burst read of LSB, MSB and MMSB so that the value can not change
+  // between bytes. 
+  readRegisters(ENERGY_LIGHT_LSB, _energyBytes, 3);
+  return decodeEnergy(_energyBytes);
+}
+
+// REG0x03 - REG0x07
+// Reads the interrupt, energy and distance registers in a single bus
+// transaction and decodes them into the given event. Because the registers
+// are read together the energy bytes can not change between reads. 
+template <class Transport>
+bool AS3935Driver<Transport>::readEventSnapshot(lightningEvent &_event)
+{
+  // Same settling time as readInterruptReg(), see "Interrupt Management" in
+  // the datasheet. 
+  blockingDelay(2);
+  _event.timestamp = _transport.nowMillis(); 
+  return readEventRegisters(_event); 
+}
+
+// Stores the time of the IRQ edge for poll(). Only touches two variables so
+// that it can be called from an interrupt service routine, under the lock
+// that poll() and irqAge() take for a GPIO thread. 
+template <class Transport>
+void AS3935Driver<Transport>::notifyIrq()
+{
+  uint32_t _now = _transport.nowMicros(); 
+  _transport.lockFromIrq(); 
+  _irqMicros = _now; 
+  _irqPending = true; 
+  _transport.unlockFromIrq(); 
+}
+
+// Reads the event reported by notifyIrq() once the IC has had 2ms to populate
+// its registers, without blocking in the meantime. 
+template <class Transport>
+pollStatus AS3935Driver<Transport>::poll(lightningEvent &_event)
+{
+  // The timestamp is 32 bits and written from an ISR, so copy it with
+  // interrupts off. 
+  _transport.disableIrq(); 
+  bool _pending = _irqPending; 
+  uint32_t _elapsed = _transport.nowMicros() - _irqMicros; 
+  if(_pending && (_elapsed >= IRQ_SETTLE_US))
+    _irqPending = false; // IRQ stays HIGH until REG0x03 is read, so no edge is lost.
+  _transport.enableIrq(); 
+
+  if(!_pending)
+    return POLL_IDLE; 
+  if(_elapsed < IRQ_SETTLE_US)
+    return POLL_NOT_READY; 
+
+  _event.timestamp = _transport.nowMillis() - (_elapsed / 1000); 
+  if(!readEventRegisters(_event)){
+    // IRQ stays HIGH as REG0x03 was not read, so keep the edge for a retry. 
+    _transport.disableIrq(); 
+    _irqPending = true; 
+    _transport.enableIrq(); 
+    return POLL_BUS_ERROR; 
+  }
+  // A glitch on the pin, an oscillator shown on it or an interrupt already
+  // read elsewhere leaves REG0x03 empty: there is no event. 
+  if(_event.interrupt == 0)
+    return POLL_IDLE; 
+#ifdef AS3935_INSTRUMENTATION
+  recordLatency(_elapsed); 
+#endif
+  if( (_event.interrupt == LIGHTNING) && (_elapsed > LIGHTNING_WINDOW_US) )
+    return POLL_LATE_EVENT; 
+  // Past the longest window the register may already have been cleared, so
+  // anything but the persistent noise interrupt is suspect. 
+  if( (_event.interrupt != NOISE_TO_HIGH) && (_elapsed > DISTURBER_WINDOW_US) )
+    return POLL_LATE_EVENT; 
+  return POLL_EVENT; 
+}
+
+// True if notifyIrq() reported an edge that poll() has not read yet. 
+template <class Transport>
+bool AS3935Driver<Transport>::irqPending()
+{
+  return _irqPending; 
+}
+
+// Microseconds since the edge reported by notifyIrq(). 
+template <class Transport>
+uint32_t AS3935Driver<Transport>::irqAge()
+{
+  _transport.disableIrq(); 
+  uint32_t _edge = _irqMicros; 
+  _transport.enableIrq(); 
+  return _transport.nowMicros() - _edge; 
+}
+
+// REG0x03, bits [3:0]
+// The interrupt was readable, so it is reported as ready to read; an edge
+// notifyIrq() already reported keeps its time. 
+template <class Transport>
+void AS3935Driver<Transport>::keepInterrupt(uint8_t _intReg)
+{
+  uint8_t _interrupt = AS3935_INT::unpack(_intReg); 
+  if(_interrupt == 0)
+    return; 
+  _keptInterrupt = _interrupt; 
+  _transport.disableIrq(); 
+  if(!_irqPending){
+    _irqMicros = _transport.nowMicros() - IRQ_SETTLE_US; 
+    _irqPending = true; 
+  }
+  _transport.enableIrq(); 
+}
+
+// The interrupt just read from REG0x03, or the kept one if it held none. A
+// kept interrupt behind a newer one stays pending for the next read; once it
+// is handed out, the edge keepInterrupt() raised for it is dropped. 
+template <class Transport>
+uint8_t AS3935Driver<Transport>::takeInterrupt(uint8_t _interrupt)
+{
+  if(_keptInterrupt == 0)
+    return _interrupt; 
+  _transport.disableIrq(); 
+  if(_interrupt != 0){
+    if(!_irqPending){
+      _irqMicros = _transport.nowMicros() - IRQ_SETTLE_US; 
+      _irqPending = true; 
+    }
+  }
+  else {
+    _interrupt = _keptInterrupt; 
+    _keptInterrupt = 0; 
+    _irqPending = false; 
+  }
+  _transport.enableIrq(); 
+  return _interrupt; 
+}
+
+// REG0x03 - REG0x07
+// Burst reads the interrupt, energy and distance registers and decodes them. 
+template <class Transport>
+bool AS3935Driver<Transport>::readEventRegisters(lightningEvent &_event)
+{
+  uint8_t _snapshot[5] = { 0 }; // REG0x03 to REG0x07
+  uint8_t _count = readRegisters(INT_MASK_ANT, _snapshot, 5);
+  _event.interrupt = AS3935_INT::unpack(_snapshot[0]); 
+  _event.energy = decodeEnergy(&_snapshot[1]);
+  _event.distance = AS3935_DISTANCE::unpack(_snapshot[4]); 
+  if(_count != 5)
+    return false; // Any kept interrupt stays for the retry. 
+  _event.interrupt = takeInterrupt(_event.interrupt); 
+  return true; 
+}
+
+// LSB =  _energyBytes[0], bits[7:0]
+// MSB =  _energyBytes[1], bits[7:0]
+// MMSB = _energyBytes[2], bits[4:0]
+template <class Transport>
+uint32_t AS3935Driver<Transport>::decodeEnergy(const uint8_t *_energyBytes)
+{
+  uint32_t _energy = AS3935_S_LIG_MM::unpack(_energyBytes[2]); //Only interested in the first four bits. 
+  _energy <<= 8; 
+  _energy |= _energyBytes[1];
+  _energy <<= 8; 
+  _energy |= _energyBytes[0];
+  return _energy;
+}
+  
+// REG0x3C
+// Sends the "Direct Command" to the DEFAULT_RESET register which sets all
+// registers back to their manufacturer defaults. 
+template <class Transport>
+void AS3935Driver<Transport>::resetSettings()
+{
+  sendDirectCommand(DEFAULT_RESET); 
+  _shadowValid = false; // Every cached register changed. 
+}
+
+// Turns the write-through shadow cache of REG0x00 - REG0x03 and REG0x08 on or
+// off. If the IC has already been started the cache is filled right away.
+template <class Transport>
+void AS3935Driver<Transport>::useShadowRegisters(bool _state)
+{
+  _shadowEnabled = _state; 
+  _shadowValid = false; 
+  if(_shadowEnabled && _started)
+    syncShadowRegisters(); 
+}
+
+// Reads the configuration registers from the IC into the shadow cache: one
+// burst for REG0x00 - REG0x03 and one for REG0x08. 
+template <class Transport>
+bool AS3935Driver<Transport>::syncShadowRegisters()
+{
+  _shadowValid = readConfigBlock(_shadowReg); 
+  return _shadowValid; 
+}
+
+// Compares the shadow cache against the IC without changing either. 
+template <class Transport>
+bool AS3935Driver<Transport>::verifyShadowRegisters()
+{
+  if(!_shadowValid)
+    return false; 
+
+  uint8_t _chipReg[SHADOW_REG_COUNT]; 
+  if(!readConfigBlock(_chipReg))
+    return false; 
+
+  for(uint8_t i = 0; i < SHADOW_REG_COUNT; i++){
+    if(_chipReg[i] != _shadowReg[i])
+      return false; 
+  }
+  return true; 
+}
+
+// REG0x00, bits [5:1]. 
+template <class Transport>
+uint8_t AS3935Driver<Transport>::readIndoorOutdoor()
+{
+  return readField<AS3935_AFE_GB>(); 
+}
+
+// REG0x01, bits[3:0]. 
+template <class Transport>
+uint8_t AS3935Driver<Transport>::readWatchdogThreshold()
+{
+  return readField<AS3935_WDTH>(); 
+}
+
+// REG0x01, bits [6:4].
+template <class Transport>
+uint8_t AS3935Driver<Transport>::readNoiseLevel()
+{
+  return readField<AS3935_NF_LEV>(); 
+}
+
+// REG0x02, bits [3:0].
+template <class Transport>
+uint8_t AS3935Driver<Transport>::readSpikeRejection()
+{
+  return readField<AS3935_SREJ>(); 
+}
+
+// REG0x02, bits [5:4]. 
+template <class Transport>
+uint8_t AS3935Driver<Transport>::readLightningThreshold()
+{
+  static const uint8_t _strikes[4] = { 1, 5, 9, 16 }; 
+  return _strikes[readField<AS3935_MIN_NUM>()]; 
+}
+
+// REG0x03, bit [5]. 
+template <class Transport>
+bool AS3935Driver<Transport>::readMaskDisturber()
+{
+  return readField<AS3935_MASK_DIST>(); 
+}
+
+// REG0x03, bit [7:6]. 
+template <class Transport>
+uint8_t AS3935Driver<Transport>::readAntennaTuning()
+{
+  return 16 << readField<AS3935_LCO_FDIV>(); 
+}
+
+// REG0x08, bits [3:0]. 
+template <class Transport>
+uint8_t AS3935Driver<Transport>::readTuneCap()
+{
+  return readField<AS3935_TUN_CAP>(); 
+}
+
+// Finds the tuning capacitor value that brings the antenna closest to 500kHz
+// with a binary search, see "Antenna Tuning" in the datasheet. 
+template <class Transport>
+bool AS3935Driver<Transport>::autoTuneAntenna(pulseCounter _counter, void *_context, tuneResult &_result, uint16_t _gateMs, uint8_t _divisionRatio)
+{
+  uint8_t _divisionBits; 
+  switch(_divisionRatio){
+    case 16:  _divisionBits = 0; break; 
+    case 32:  _divisionBits = 1; break; 
+    case 64:  _divisionBits = 2; break; 
+    case 128: _divisionBits = 3; break; 
+    default: return false; 
+  }
+  if( (_counter == NULL) || (_gateMs == 0) )
+    return false; 
+
+  uint8_t _oldDivision = readField<AS3935_LCO_FDIV>(); 
+  writeField<AS3935_LCO_FDIV>(_divisionBits); 
+  writeField<AS3935_DISP_LCO, 1>(); // Display the LCO on the IRQ pin.
+
+  // Measured frequencies, 0 until measured, so no value is counted twice. 
+  uint32_t _freq[16] = { 0 }; 
+  _result.measurements = 0; 
+
+  // Smallest capacitor value at or below 500kHz. 
+  uint8_t _low = 0; 
+  uint8_t _high = 15; 
+  while(_low < _high){
+    uint8_t _mid = (_low + _high) / 2; 
+    _freq[_mid] = measureAntenna(_mid, _counter, _context, _gateMs, _divisionRatio); 
+    _result.measurements++; 
+    if(_freq[_mid] > ANTENNA_TARGET_HZ)
+      _low = _mid + 1; 
+    else
+      _high = _mid; 
+  }
+  if(_freq[_low] == 0){
+    _freq[_low] = measureAntenna(_low, _counter, _context, _gateMs, _divisionRatio); 
+    _result.measurements++; 
+  }
+
+  // The closest value is either that one or the one just below it. 
+  uint8_t _best = _low; 
+  if(_low > 0){
+    if(_freq[_low - 1] == 0){
+      _freq[_low - 1] = measureAntenna(_low - 1, _counter, _context, _gateMs, _divisionRatio); 
+      _result.measurements++; 
+    }
+    int32_t _errorBelow = (int32_t)_freq[_low - 1] - (int32_t)ANTENNA_TARGET_HZ; 
+    int32_t _errorAt = (int32_t)_freq[_low] - (int32_t)ANTENNA_TARGET_HZ; 
+    if(labs(_errorBelow) < labs(_errorAt))
+      _best = _low - 1; 
+  }
+
+  writeField<AS3935_TUN_CAP>(_best); 
+  writeField<AS3935_DISP_LCO, 0>(); // Give the IRQ pin back to interrupts.
+  // The divided LCO on the IRQ pin was no event, forget its edges. 
+  _transport.disableIrq(); 
+  _irqPending = false; 
+  _transport.enableIrq(); 
+  writeField<AS3935_LCO_FDIV>(_oldDivision); 
+
+  int32_t _error = (int32_t)_freq[_best] - (int32_t)ANTENNA_TARGET_HZ; 
+  _result.tuneCap = _best; 
+  _result.frequency = _freq[_best]; 
+  _result.errorPermille = (_error * 1000) / (int32_t)ANTENNA_TARGET_HZ; 
+  _result.inSpec = (_result.errorPermille <= ANTENNA_TOLERANCE_PERMILLE) && (_result.errorPermille >= -ANTENNA_TOLERANCE_PERMILLE); 
+  return _result.inSpec; 
+}
+
+// Sets the tuning capacitor and measures the resulting LCO frequency over one
+// gate period. 
+template <class Transport>
+uint32_t AS3935Driver<Transport>::measureAntenna(uint8_t _cap, pulseCounter _counter, void *_context, uint16_t _gateMs, uint8_t _divisionRatio)
+{
+  writeField<AS3935_TUN_CAP>(_cap); 
+  uint32_t _edges = _counter(_gateMs, _context); 
+  return (_edges * _divisionRatio * 1000UL) / _gateMs; 
+}
+
+// Fills the given configuration with the IC's current settings, from the
+// shadow cache when it is valid. 
+template <class Transport>
+bool AS3935Driver<Transport>::readConfig(AS3935Config &_config)
+{
+  uint8_t _regs[SHADOW_REG_COUNT]; 
+  if(_shadowValid)
+    memcpy(_regs, _shadowReg, SHADOW_REG_COUNT); 
+  else if(!readConfigBlock(_regs))
+    return false; 
+
+  static const uint8_t _strikes[4] = { 1, 5, 9, 16 }; 
+  _config.indoorOutdoor = AS3935_AFE_GB::unpack(_regs[0]); 
+  _config.watchdog = AS3935_WDTH::unpack(_regs[1]); 
+  _config.noiseLevel = AS3935_NF_LEV::unpack(_regs[1]); 
+  _config.spike = AS3935_SREJ::unpack(_regs[2]); 
+  _config.strikes = _strikes[AS3935_MIN_NUM::unpack(_regs[2])]; 
+  _config.maskDisturber = AS3935_MASK_DIST::unpack(_regs[3]); 
+  _config.divisionRatio = 16 << AS3935_LCO_FDIV::unpack(_regs[3]); 
+  _config.tuneCap = AS3935_TUN_CAP::unpack(_regs[4]); 
+  return true; 
+}
+
+// Validates the whole configuration first, then packs every field into its
+// register and writes only what changed: REG0x00 - REG0x03 as one burst
+// spanning the first to the last changed register, and REG0x08 on its own. 
+template <class Transport>
+bool AS3935Driver<Transport>::applyConfig(const AS3935Config &_config)
+{
+  // Nothing is written unless every field is valid. 
+  uint8_t _bits[SHADOW_REG_COUNT]; 
+  uint8_t _masks[SHADOW_REG_COUNT]; 
+  if(!packConfig(_config, _bits, _masks))
+    return false; 
+
+  uint8_t _current[SHADOW_REG_COUNT]; 
+  if(_shadowValid)
+    memcpy(_current, _shadowReg, SHADOW_REG_COUNT); 
+  else if(!readConfigBlock(_current))
+    return false; 
+
+  // Bits that are not part of the configuration (power down, clear
+  // statistics, reserved and oscillator display bits) are kept as they are. 
+  uint8_t _wanted[SHADOW_REG_COUNT]; 
+  for(uint8_t i = 0; i < SHADOW_REG_COUNT; i++)
+    _wanted[i] = (_current[i] & ~_masks[i]) | _bits[i]; 
+
+  int8_t _first = -1; 
+  int8_t _last = -1; 
+  for(int8_t i = 0; i < 4; i++){
+    if(_wanted[i] != _current[i]){
+      if(_first < 0)
+        _first = i; 
+      _last = i; 
+    }
+  }
+  bool _ok = true; 
+  if(_first >= 0)
+    _ok &= writeRegisters(AFE_GAIN + _first, &_wanted[_first], _last - _first + 1); 
+  if(_wanted[4] != _current[4])
+    _ok &= writeRegisters(FREQ_DISP_IRQ, &_wanted[4], 1); 
+
+  // After a bus error it is unknown what the IC holds. 
+  if(_ok && _shadowValid)
+    memcpy(_shadowReg, _wanted, SHADOW_REG_COUNT); 
+  else
+    _shadowValid = false; 
+  return _ok; 
+}
+
+// Same ranges as the individual setters. 
+template <class Transport>
+bool AS3935Driver<Transport>::packConfig(const AS3935Config &_config, uint8_t *_bits, uint8_t *_masks)
+{
+  if( (_config.indoorOutdoor != INDOOR) && (_config.indoorOutdoor != OUTDOOR) )
+    return false; 
+  if( (_config.noiseLevel < 1) || (_config.noiseLevel > 7) )
+    return false; 
+  if( (_config.watchdog < 1) || (_config.watchdog > 10) )
+    return false; 
+  if( (_config.spike < 1) || (_config.spike > 11) )
+    return false; 
+  if(_config.tuneCap > 15)
+    return false; 
+
+  uint8_t _strikeBits; 
+  switch(_config.strikes){
+    case 1:  _strikeBits = 0; break; 
+    case 5:  _strikeBits = 1; break; 
+    case 9:  _strikeBits = 2; break; 
+    case 16: _strikeBits = 3; break; 
+    default: return false; 
+  }
+  uint8_t _divisionBits; 
+  switch(_config.divisionRatio){
+    case 16:  _divisionBits = 0; break; 
+    case 32:  _divisionBits = 1; break; 
+    case 64:  _divisionBits = 2; break; 
+    case 128: _divisionBits = 3; break; 
+    default: return false; 
+  }
+
+  _bits[0] = AS3935_AFE_GB::pack(_config.indoorOutdoor); 
+  _masks[0] = AS3935_AFE_GB::mask; 
+  _bits[1] = AS3935_NF_LEV::pack(_config.noiseLevel) | AS3935_WDTH::pack(_config.watchdog); 
+  _masks[1] = AS3935_NF_LEV::mask | AS3935_WDTH::mask; 
+  _bits[2] = AS3935_MIN_NUM::pack(_strikeBits) | AS3935_SREJ::pack(_config.spike); 
+  _masks[2] = AS3935_MIN_NUM::mask | AS3935_SREJ::mask; 
+  _bits[3] = AS3935_LCO_FDIV::pack(_divisionBits) | AS3935_MASK_DIST::pack(_config.maskDisturber); 
+  _masks[3] = AS3935_LCO_FDIV::mask | AS3935_MASK_DIST::mask; 
+  _bits[4] = AS3935_TUN_CAP::pack(_config.tuneCap); 
+  _masks[4] = AS3935_TUN_CAP::mask; 
+  return true; 
+}
+
+// Non-blocking read, the data is in _buf once pollTransfer() says
+// TRANSFER_DONE. 
+template <class Transport>
+bool AS3935Driver<Transport>::startRead(uint8_t _reg, uint8_t *_buf, uint8_t _len)
+{
+  if(!_transport.startRead(_reg, _buf, _len))
+    return false; 
+#ifdef AS3935_INSTRUMENTATION
+  _stats.reads++; 
+  _transferWrite = false; 
+  _transferLen = _len; 
+#endif
+  return true; 
+}
+
+// Non-blocking write. The shadow cache can not follow a write that may still
+// fail, so it is dropped instead, as it is for DEFAULT_RESET. 
+template <class Transport>
+bool AS3935Driver<Transport>::startWrite(uint8_t _reg, const uint8_t *_buf, uint8_t _len)
+{
+  if(!_transport.startWrite(_reg, _buf, _len))
+    return false; 
+  if( (_reg <= INT_MASK_ANT) || ((_reg <= FREQ_DISP_IRQ) && (_reg + _len > FREQ_DISP_IRQ)) ||
+      ((_reg <= DEFAULT_RESET) && (_reg + _len > DEFAULT_RESET)) )
+    _shadowValid = false; 
+#ifdef AS3935_INSTRUMENTATION
+  _stats.writes++; 
+  _transferWrite = true; 
+  _transferLen = _len; 
+#endif
+  return true; 
+}
+
+template <class Transport>
+transferStatus AS3935Driver<Transport>::pollTransfer()
+{
+  transferStatus _status = _transport.pollTransfer(); 
+#ifdef AS3935_INSTRUMENTATION
+  // Counted once, the first time the transfer is seen to be over. 
+  if( (_transferLen > 0) && (_status != TRANSFER_BUSY) ){
+    if(_status == TRANSFER_DONE){
+      if(_transferWrite)
+        _stats.bytesWritten += _transferLen; 
+      else
+        _stats.bytesRead += _transferLen; 
+    }
+    else if(_transferWrite)
+      _stats.writeErrors++; 
+    else
+      _stats.readErrors++; 
+    _transferLen = 0; 
+  }
+#endif
+  return _status; 
+}
+
+template <class Transport>
+void AS3935Driver<Transport>::abortTransfer()
+{
+  _transport.abortTransfer(); 
+#ifdef AS3935_INSTRUMENTATION
+  if( (_transferLen > 0) && _transferWrite )
+    _stats.writeErrors++; 
+  else if(_transferLen > 0)
+    _stats.readErrors++; 
+  _transferLen = 0; 
+#endif
+}
+
+// REG0x00 - REG0x08, REG0x3A and REG0x3B
+// Two burst reads: the register block and the calibration status. 
+template <class Transport>
+bool AS3935Driver<Transport>::saveState(as3935State &_state)
+{
+  memset(&_state, 0, sizeof(_state)); 
+  _state.magic = STATE_MAGIC; 
+  uint8_t _count = readRegisters(AFE_GAIN, _state.regs, STATE_REG_COUNT); 
+  if(_count == STATE_REG_COUNT)
+    keepInterrupt(_state.regs[INT_MASK_ANT]); 
+  _count += readRegisters(CALIB_TRCO, _state.calibration, 2); 
+  _state.regs[INT_MASK_ANT] &= INT_MASK; // Interrupt bits are status.
+  _state.checksum = stateChecksum(_state); 
+  return (_count == STATE_REG_COUNT + 2); 
+}
+
+// Writes back only the configuration registers that differ from _state. 
+template <class Transport>
+bool AS3935Driver<Transport>::restoreState(const as3935State &_state)
+{
+  if(!validState(_state))
+    return false; 
+
+  uint8_t _current[STATE_REG_COUNT]; 
+  if(readRegisters(AFE_GAIN, _current, STATE_REG_COUNT) != STATE_REG_COUNT)
+    return false; 
+  keepInterrupt(_current[INT_MASK_ANT]); 
+  _current[INT_MASK_ANT] &= INT_MASK; 
+
+  // REG0x00 - REG0x03 in one burst from the first to the last change. 
+  int8_t _first = -1; 
+  int8_t _last = -1; 
+  for(int8_t i = 0; i <= INT_MASK_ANT; i++){
+    if(_state.regs[i] != _current[i]){
+      if(_first < 0)
+        _first = i; 
+      _last = i; 
+    }
+  }
+  bool _ok = true; 
+  if(_first >= 0)
+    _ok &= writeRegisters(AFE_GAIN + _first, &_state.regs[_first], _last - _first + 1); 
+  if(_state.regs[FREQ_DISP_IRQ] != _current[FREQ_DISP_IRQ])
+    _ok &= writeRegisters(FREQ_DISP_IRQ, &_state.regs[FREQ_DISP_IRQ], 1); 
+
+  // The IC now holds exactly the saved configuration. 
+  if(_ok && _shadowEnabled){
+    memcpy(_shadowReg, _state.regs, 4); 
+    _shadowReg[4] = _state.regs[FREQ_DISP_IRQ]; 
+    _shadowValid = true; 
+  }
+  else
+    _shadowValid = false; 
+  return _ok; 
+}
+
+// True if _state has the magic number and a matching checksum. 
+template <class Transport>
+bool AS3935Driver<Transport>::validState(const as3935State &_state)
+{
+  return (_state.magic == STATE_MAGIC) && (_state.checksum == stateChecksum(_state)); 
+}
+
+// CRC-8, polynomial 0x31 and initial value 0xFF, over every byte before the
+// checksum. 
+template <class Transport>
+uint8_t AS3935Driver<Transport>::stateChecksum(const as3935State &_state)
+{
+  const uint8_t *_bytes = (const uint8_t *)&_state; 
+  uint8_t _crc = 0xFF; 
+  for(size_t i = 0; i < offsetof(as3935State, checksum); i++){
+    _crc ^= _bytes[i]; 
+    for(uint8_t b = 0; b < 8; b++)
+      _crc = (_crc & 0x80) ? ((_crc << 1) ^ 0x31) : (_crc << 1); 
+  }
+  return _crc; 
+}
+
+// Reads REG0x00 - REG0x03 in one burst and REG0x08 in another. The interrupt
+// bits of REG0x03 are status and not configuration, so they are handed to
+// keepInterrupt() and cleared. 
+template <class Transport>
+bool AS3935Driver<Transport>::readConfigBlock(uint8_t *_regs)
+{
+  uint8_t _count = readRegisters(AFE_GAIN, _regs, 4); 
+  if(_count == 4)
+    keepInterrupt(_regs[3]); 
+  _count += readRegisters(FREQ_DISP_IRQ, &_regs[4], 1); 
+  _regs[3] &= INT_MASK; 
+  return (_count == SHADOW_REG_COUNT); 
+}
+
+// Returns the shadow cache index of a configuration register, or -1 if the
+// register is not cached. 
+template <class Transport>
+int8_t AS3935Driver<Transport>::shadowIndex(uint8_t _reg)
+{
+  if(_reg <= INT_MASK_ANT)
+    return _reg; 
+  if(_reg == FREQ_DISP_IRQ)
+    return 4; 
+  return -1; 
+}
+
+// Reads a configuration register, from the shadow cache when it is valid. 
+template <class Transport>
+uint8_t AS3935Driver<Transport>::readConfigRegister(uint8_t _reg)
+{
+  int8_t _index = shadowIndex(_reg); 
+  if(_shadowEnabled && !_shadowValid && _started)
+    syncShadowRegisters(); 
+  if(_shadowValid && (_index >= 0))
+    return _shadowReg[_index]; 
+  uint8_t _value = readRegister(_reg); 
+  if(_reg == INT_MASK_ANT)
+    keepInterrupt(_value); 
+  return _value; 
+}
+
+// This function handles all write commands. It takes the register to write
+// to, then will mask the part of the register that coincides with the
+// field, and then write the field's bits, already in place, into it. 
+template <class Transport>
+void AS3935Driver<Transport>::writeRegister(uint8_t _wReg, uint8_t _mask, uint8_t _packed)
+{
+  uint8_t _value = readConfigRegister(_wReg); // Get the current value of the register
+  _value &= (~_mask); // Mask the position we want to write to
+  _value |= (_packed & _mask); // Write the given bits to the variable
+  bool _ok = writeRegisters(_wReg, &_value, 1); 
+
+  // Keep the shadow cache in step with what was just written. After a failed
+  // write the IC may hold either value, so the cache is read again instead. 
+  int8_t _index = shadowIndex(_wReg); 
+  if(!_ok && (_index >= 0))
+    _shadowValid = false; 
+  else if(_shadowValid && (_index >= 0)){
+    _shadowReg[_index] = _value; 
+    if(_wReg == INT_MASK_ANT)
+      _shadowReg[_index] &= INT_MASK; // Interrupt bits are status, not configuration.
+  }
+}
+
+// This function reads the given register. 
+template <class Transport>
+uint8_t AS3935Driver<Transport>::readRegister(uint8_t _reg)
+{
+  uint8_t _regValue = 0; 
+  readRegisters(_reg, &_regValue, 1); 
+  return(_regValue); 
+}
+
+// This function reads _len consecutive registers starting at _reg. The IC
+// auto-increments its register pointer, so the transport reads all of them
+// in a single transaction. 
+template <class Transport>
+uint8_t AS3935Driver<Transport>::readRegisters(uint8_t _reg, uint8_t *_buf, uint8_t _len)
+{
+#ifdef AS3935_INSTRUMENTATION
+  uint32_t _start = _transport.nowMicros(); 
+  uint8_t _count = _transport.readRegisters(_reg, _buf, _len); 
+  _stats.busMicros += _transport.nowMicros() - _start; 
+  _stats.reads++; 
+  _stats.bytesRead += _count; 
+  if(_count != _len)
+    _stats.readErrors++; 
+  return _count; 
+#else
+  return _transport.readRegisters(_reg, _buf, _len); 
+#endif
+}
+
+// This function writes _len consecutive registers starting at _reg from _buf
+// as is. Unlike writeRegister() nothing is read first. 
+template <class Transport>
+bool AS3935Driver<Transport>::writeRegisters(uint8_t _reg, const uint8_t *_buf, uint8_t _len)
+{
+#ifdef AS3935_INSTRUMENTATION
+  uint32_t _start = _transport.nowMicros(); 
+  bool _ok = _transport.writeRegisters(_reg, _buf, _len); 
+  _stats.busMicros += _transport.nowMicros() - _start; 
+  _stats.writes++; 
+  if(_ok)
+    _stats.bytesWritten += _len; 
+  else
+    _stats.writeErrors++; 
+  return _ok; 
+#else
+  return _transport.writeRegisters(_reg, _buf, _len); 
+#endif
+}
+
+// Every blocking delay of the driver goes through here so that it can be
+// accounted for. 
+template <class Transport>
+void AS3935Driver<Transport>::blockingDelay(uint16_t _ms)
+{
+#ifdef AS3935_INSTRUMENTATION
+  uint32_t _start = _transport.nowMicros(); 
+  _transport.delayMs(_ms); 
+  _stats.blockedMicros += _transport.nowMicros() - _start; 
+#else
+  _transport.delayMs(_ms); 
+#endif
+}
+
+#ifdef AS3935_INSTRUMENTATION
+// Copies the bus and timing counters. 
+template <class Transport>
+void AS3935Driver<Transport>::readInstrumentation(instrumentationSnapshot &_snapshot)
+{
+  _snapshot = _stats; 
+}
+
+// Starts counting from zero. 
+template <class Transport>
+void AS3935Driver<Transport>::clearInstrumentation()
+{
+  memset(&_stats, 0, sizeof(_stats)); 
+}
+
+// Bucket 0 is under 2048us, each following bucket doubles the limit. 
+template <class Transport>
+void AS3935Driver<Transport>::recordLatency(uint32_t _micros)
+{
+  uint8_t _bucket = 0; 
+  uint32_t _limit = 2048; 
+  while( (_bucket < LATENCY_BUCKETS - 1) && (_micros >= _limit) ){
+    _bucket++; 
+    _limit <<= 1; 
+  }
+  _stats.latency[_bucket]++; 
+  _stats.events++; 
+  if(_micros > _stats.maxLatencyMicros)
+    _stats.maxLatencyMicros = _micros; 
+}
+#endif
+
+// REG0x3C or REG0x3D
+// Direct commands are written as is, there is nothing to read-modify-write. 
+template <class Transport>
+void AS3935Driver<Transport>::sendDirectCommand(uint8_t _reg)
+{
+  uint8_t _command = DIRECT_COMMAND; 
+  writeRegisters(_reg, &_command, 1); 
+}
+
+#endif
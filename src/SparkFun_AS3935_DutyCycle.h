@@ -0,0 +1,197 @@
+#ifndef _SPARKFUN_AS3935_DUTYCYCLE_H_
+#define _SPARKFUN_AS3935_DUTYCYCLE_H_
+
+#include "SparkFun_AS3935_Core.h"
+
+// Defined in SparkFun_AS3935.h, include that first on Arduino.
+class SparkFun_AS3935; 
+
+// Schedule of AS3935DutyCycle. The IC listens for listenMs, then powers down
+// for sleepMs, over and over. A strike keeps it listening for holdMs.
+struct dutyCycleSettings {
+
+  uint32_t listenMs       = 60000;    // Listening part of each cycle.
+  uint32_t sleepMs        = 240000;   // Powered down part of each cycle, 0 never sleeps.
+  uint32_t holdMs         = 900000;   // Listening kept up after a strike.
+
+};
+
+// What the duty cycle has cost so far, see AS3935DutyCycle::stats().
+typedef struct AS3935_DUTY_CYCLE_STATS {
+
+  uint32_t awakeMs;         // Time listening or waking up.
+  uint32_t asleepMs;        // Time powered down.
+  uint16_t wakes;           // Wake ups started, each calibrates the RC oscillators.
+  uint16_t wakeFailures;    // Wake ups whose calibration or config restore failed.
+  uint32_t lastWakeMicros;  // Wake up latency: from the scheduled time or
+  uint32_t maxWakeMicros;   // trigger() until listening with the config restored.
+
+} dutyCycleStats; 
+
+typedef enum SF_AS3935_DUTY_STATE {
+
+  DUTY_LISTENING = 0,
+  DUTY_SLEEPING,
+  DUTY_WAKING
+
+} dutyState; 
+
+// Keeps the detector powered down outside its listening periods. Call
+// service() from the loop; it never blocks, waking goes through startWakeUp()
+// and step(). Every wake recalibrates the RC oscillators, which the datasheet
+// requires after a power down, and the configuration given to begin() is
+// restored with applyConfig(), which writes only registers that differ.
+// trigger() wakes it early, e.g. from a rain sensor or another node, and is
+// safe to call from an ISR. Sensor is any AS3935Driver, or the
+// SparkFun_AS3935 wrapper by default.
+template <class Sensor = SparkFun_AS3935>
+class AS3935DutyCycle
+{
+  public:
+    AS3935DutyCycle(Sensor &_sensor, const dutyCycleSettings &_settings = dutyCycleSettings()) :
+      _detector(&_sensor), _schedule(_settings) { }
+
+    // Starts a listening period with the detector already running and
+    // configured as _wanted, which is what every wake up restores.
+    void begin(const AS3935Config &_wanted)
+    {
+      _config = _wanted; 
+      memset(&_stats, 0, sizeof(_stats)); 
+      _state = DUTY_LISTENING; 
+      _stateStart = _detector->transport().nowMillis(); 
+      _accounted = _stateStart; 
+      _struck = false; 
+      _triggered = false; 
+    }
+
+    // Wakes the detector at the next service() instead of the scheduled time.
+    void trigger()
+    {
+      if(!_triggered){
+        _triggerMicros = _detector->transport().nowMicros(); 
+        _triggered = true; 
+      }
+    }
+
+    // Hand every event read to this, lightning extends the listening period.
+    void record(uint8_t _interrupt)
+    {
+      if(_interrupt == LIGHTNING){
+        _lastStrike = _detector->transport().nowMillis(); 
+        _struck = true; 
+      }
+    }
+
+    // Advances the schedule. Returns true while the detector is listening.
+    bool service()
+    {
+      uint32_t _now = _detector->transport().nowMillis(); 
+      account(_now); 
+
+      switch(_state){
+        case DUTY_LISTENING:
+          _triggered = false; // Already awake.
+          if( (_schedule.sleepMs == 0) || ((_now - _stateStart) < _schedule.listenMs) )
+            return true; 
+          if( _struck && ((_now - _lastStrike) < _schedule.holdMs) )
+            return true; 
+          _struck = false; 
+          _detector->powerDown(); 
+          enter(DUTY_SLEEPING, _now); 
+          return false; 
+
+        case DUTY_SLEEPING:
+        {
+          bool _wake = (_now - _stateStart) >= _schedule.sleepMs; 
+          _detector->transport().disableIrq(); 
+          bool _early = _triggered; 
+          uint32_t _since = _triggerMicros; 
+          _triggered = false; 
+          _detector->transport().enableIrq(); 
+          if(!_wake && !_early)
+            return false; 
+          // Latency counts from the trigger, or from when the wake was due.
+          _wakeMicros = _early ? _since :
+            _detector->transport().nowMicros() - (_now - _stateStart - _schedule.sleepMs) * 1000UL; 
+          _detector->startWakeUp(); 
+          _stats.wakes++; 
+          enter(DUTY_WAKING, _now); 
+          return false; 
+        }
+
+        case DUTY_WAKING:
+          if(!_detector->step())
+            return false; 
+          if(!_detector->isReady() || !_detector->applyConfig(_config)){
+            // Try again after another sleep rather than listen uncalibrated
+            // or with a configuration only partly restored.
+            _stats.wakeFailures++; 
+            _detector->powerDown(); 
+            enter(DUTY_SLEEPING, _now); 
+            return false; 
+          }
+          _stats.lastWakeMicros = _detector->transport().nowMicros() - _wakeMicros; 
+          if(_stats.lastWakeMicros > _stats.maxWakeMicros)
+            _stats.maxWakeMicros = _stats.lastWakeMicros; 
+          enter(DUTY_LISTENING, _detector->transport().nowMillis()); 
+          return true; 
+
+        default:
+          return false; 
+      }
+    }
+
+    dutyState state() const { return _state; }
+
+    // Counters, with the time spent in the current state included.
+    const dutyCycleStats &stats()
+    {
+      account(_detector->transport().nowMillis()); 
+      return _stats; 
+    }
+
+    // Share of the time the detector was powered up, in tenths of a percent.
+    uint16_t dutyCyclePermille()
+    {
+      const dutyCycleStats &_totals = stats(); 
+      uint32_t _total = _totals.awakeMs + _totals.asleepMs; 
+      if(_total == 0)
+        return 1000; 
+      return (uint16_t)(((uint64_t)_totals.awakeMs * 1000) / _total); 
+    }
+
+  private:
+
+    void enter(dutyState _next, uint32_t _now)
+    {
+      account(_now); 
+      _state = _next; 
+      _stateStart = _now; 
+    }
+
+    // Adds the time since the last call to the awake or asleep total.
+    void account(uint32_t _now)
+    {
+      uint32_t _elapsed = _now - _accounted; 
+      if(_state == DUTY_SLEEPING)
+        _stats.asleepMs += _elapsed; 
+      else
+        _stats.awakeMs += _elapsed; 
+      _accounted = _now; 
+    }
+
+    Sensor *_detector; 
+    dutyCycleSettings _schedule; 
+    AS3935Config _config; 
+    dutyCycleStats _stats = dutyCycleStats(); 
+    dutyState _state = DUTY_LISTENING; 
+    uint32_t _stateStart = 0;  // millis() when the current state began.
+    uint32_t _accounted = 0;   // millis() up to which time has been counted.
+    uint32_t _lastStrike = 0; 
+    bool _struck = false; 
+    uint32_t _wakeMicros = 0; 
+    volatile bool _triggered = false; 
+    volatile uint32_t _triggerMicros = 0; 
+
+};
+#endif
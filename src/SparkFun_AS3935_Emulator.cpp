@@ -0,0 +1,353 @@
+/*
+  Software model of the ASM AS3935 Franklin Lightning Detector, see
+  SparkFun_AS3935_Emulator.h.
+*/
+
+#if !defined(ARDUINO)
+
+#include "SparkFun_AS3935_Emulator.h"
+
+// Bit masks of the emulated registers, see the register table in the
+// datasheet. 
+#define EMU_PWD        0x01 // REG0x00 [0]
+#define EMU_CL_STAT    0x40 // REG0x02 [6]
+#define EMU_MASK_DIST  0x20 // REG0x03 [5]
+#define EMU_DISP_LCO   0x80 // REG0x08 [7]
+#define EMU_NS_PER_US  1000ULL
+#define EMU_NS_PER_S   1000000000ULL
+
+AS3935Emulator::AS3935Emulator() :
+  _nowNanos(0), _present(true), _failCalib(false), _eventNanos(0), _calibNanos(0),
+  _lcoBaseHz(530000), _lcoStepHz(4000)
+{
+  memset(_regs, 0, sizeof(_regs)); 
+  powerOn(); 
+}
+
+void AS3935Emulator::powerOn()
+{
+  loadDefaults(); 
+  _regs[CALIB_TRCO] = 0; 
+  _regs[CALIB_SRCO] = 0; 
+  _calibrating = false; 
+}
+
+// Manufacturer defaults: AFE_GB INDOOR, NF_LEV 2, WDTH 2, CL_STAT 1, SREJ 2,
+// and distance "out of range". 
+void AS3935Emulator::loadDefaults()
+{
+  uint8_t _calibT = _regs[CALIB_TRCO]; 
+  uint8_t _calibS = _regs[CALIB_SRCO]; 
+  memset(_regs, 0, sizeof(_regs)); 
+  _regs[AFE_GAIN] = INDOOR << 1; 
+  _regs[THRESHOLD] = 0x22; 
+  _regs[LIGHTNING_REG] = 0xC2; 
+  _regs[DISTANCE] = 0x3F; 
+  _regs[CALIB_TRCO] = _calibT; 
+  _regs[CALIB_SRCO] = _calibS; 
+  _irq = false; 
+  _latched = 0; 
+  _strikeCount = 0; 
+}
+
+uint8_t AS3935Emulator::readRegister(uint8_t _reg)
+{
+  _reg &= 0x3F; 
+  update(); 
+  uint8_t _value = _regs[_reg]; 
+  // The interrupt is cleared, and IRQ goes LOW, once REG0x03 has been read
+  // with the interrupt in it. 
+  if( (_reg == INT_MASK_ANT) && (_value & ~INT_MASK) ){
+    _regs[INT_MASK_ANT] &= INT_MASK; 
+    _latched = 0; 
+    _irq = false; 
+  }
+  return _value; 
+}
+
+void AS3935Emulator::writeRegister(uint8_t _reg, uint8_t _value)
+{
+  _reg &= 0x3F; 
+  update(); 
+
+  switch(_reg){
+    case AFE_GAIN:
+      // Powering down loses the RC oscillator calibration. 
+      if( (_value & EMU_PWD) && !(_regs[AFE_GAIN] & EMU_PWD) ){
+        _regs[CALIB_TRCO] = 0; 
+        _regs[CALIB_SRCO] = 0; 
+      }
+      _regs[AFE_GAIN] = _value & 0x3F; 
+      break; 
+
+    case THRESHOLD:
+      _regs[THRESHOLD] = _value & 0x7F; 
+      break; 
+
+    case LIGHTNING_REG:
+      // CL_STAT HIGH, LOW, HIGH clears the strike count; the LOW does it here.
+      if( !(_value & EMU_CL_STAT) && (_regs[LIGHTNING_REG] & EMU_CL_STAT) )
+        _strikeCount = 0; 
+      _regs[LIGHTNING_REG] = _value & 0x7F; 
+      break; 
+
+    case INT_MASK_ANT:
+      // Bits [3:0] are the read only interrupt. 
+      _regs[INT_MASK_ANT] = (_value & INT_MASK) | (_regs[INT_MASK_ANT] & ~INT_MASK); 
+      break; 
+
+    case FREQ_DISP_IRQ:
+      _regs[FREQ_DISP_IRQ] = _value; 
+      break; 
+
+    case DEFAULT_RESET:
+      if(_value == DIRECT_COMMAND)
+        loadDefaults(); 
+      break; 
+
+    case CALIB_RCO:
+      if(_value == DIRECT_COMMAND){
+        _regs[CALIB_TRCO] = 0; 
+        _regs[CALIB_SRCO] = 0; 
+        _calibrating = true; 
+        _calibNanos = _nowNanos; 
+      }
+      break; 
+
+    default:
+      break; // Energy, distance and calibration status are read only.
+  }
+}
+
+void AS3935Emulator::injectLightning(uint32_t _energy, uint8_t _distance, uint8_t _strength)
+{
+  if(_regs[AFE_GAIN] & EMU_PWD)
+    return; 
+  if( (_strength <= (_regs[THRESHOLD] & 0x0F)) || (_strength <= (_regs[LIGHTNING_REG] & 0x0F)) )
+    return; // Below the watchdog or rejected as a spike. 
+
+  _regs[ENERGY_LIGHT_LSB] = _energy & 0xFF; 
+  _regs[ENERGY_LIGHT_MSB] = (_energy >> 8) & 0xFF; 
+  _regs[ENERGY_LIGHT_MMSB] = (_energy >> 16) & 0x1F; 
+  _regs[DISTANCE] = _distance & 0x3F; 
+
+  // REG0x02 [5:4]: 1, 5, 9 or 16 strikes before the first interrupt. 
+  static const uint8_t _minimum[4] = { 1, 5, 9, 16 }; 
+  if(_strikeCount < 255)
+    _strikeCount++; 
+  if(_strikeCount >= _minimum[(_regs[LIGHTNING_REG] >> 4) & 0x03])
+    raise(LIGHTNING); 
+}
+
+void AS3935Emulator::injectDisturber(uint8_t _strength)
+{
+  if( (_regs[AFE_GAIN] & EMU_PWD) || (_regs[INT_MASK_ANT] & EMU_MASK_DIST) )
+    return; 
+  if(_strength <= (_regs[THRESHOLD] & 0x0F))
+    return; // Below the watchdog threshold. 
+  raise(DISTURBER_DETECT); 
+}
+
+void AS3935Emulator::injectNoise(uint8_t _level)
+{
+  if(_regs[AFE_GAIN] & EMU_PWD)
+    return; 
+  if(_level <= ((_regs[THRESHOLD] >> 4) & 0x07))
+    return; // Under the noise floor. 
+  raise(NOISE_TO_HIGH); 
+}
+
+// Antenna frequency at the current tuning capacitor value. 
+uint32_t AS3935Emulator::lcoFrequency() const
+{
+  uint32_t _drop = _lcoStepHz * (_regs[FREQ_DISP_IRQ] & 0x0F); 
+  return (_drop < _lcoBaseHz) ? (_lcoBaseHz - _drop) : 0; 
+}
+
+uint32_t AS3935Emulator::countPulses(uint16_t _gateMs, void *_emulator)
+{
+  AS3935Emulator *_emu = (AS3935Emulator *)_emulator; 
+  _emu->advanceMillis(_gateMs); 
+  if(!(_emu->_regs[FREQ_DISP_IRQ] & EMU_DISP_LCO))
+    return 0; 
+  uint32_t _division = 16UL << ((_emu->_regs[INT_MASK_ANT] >> 6) & 0x03); 
+  return (uint32_t)(((uint64_t)_emu->lcoFrequency() * _gateMs) / (1000ULL * _division)); 
+}
+
+void AS3935Emulator::raise(uint8_t _interrupt)
+{
+  _latched = _interrupt; 
+  _eventNanos = _nowNanos; 
+  _regs[INT_MASK_ANT] &= INT_MASK; // Readable after the settling time.
+  _irq = true; 
+}
+
+void AS3935Emulator::update()
+{
+  if(_latched){
+    uint64_t _age = _nowNanos - _eventNanos; 
+    uint64_t _window = (_latched == LIGHTNING) ? (LIGHTNING_WINDOW_US * EMU_NS_PER_US) :
+      (_latched == DISTURBER_DETECT) ? (DISTURBER_WINDOW_US * EMU_NS_PER_US) : 0; 
+    if( _window && (_age > _window) ){
+      // Not read in time: the event is gone. 
+      _regs[INT_MASK_ANT] &= INT_MASK; 
+      _latched = 0; 
+      _irq = false; 
+    }
+    else if(_age >= IRQ_SETTLE_US * EMU_NS_PER_US)
+      _regs[INT_MASK_ANT] = (_regs[INT_MASK_ANT] & INT_MASK) | _latched; 
+  }
+
+  if( _calibrating && ((_nowNanos - _calibNanos) >= CALIB_RCO_US * EMU_NS_PER_US) ){
+    uint8_t _status = _failCalib ? (CALIB_DONE_M | CALIB_NOK_M) : CALIB_DONE_M; 
+    _regs[CALIB_TRCO] = _status; 
+    _regs[CALIB_SRCO] = _status; 
+    _calibrating = false; 
+  }
+}
+
+// I2C: START, address + W, then STOP. 
+bool AS3935EmulatorTransport::probe()
+{
+  _counters.probes++; 
+  _counters.wireBytes += 1; 
+  if(_sessionDepth == 0)
+    _counters.setups++; 
+  _held = false; // A probe always ends with a STOP. 
+  spendBits(1 + 9 + 1); 
+  return _emulator->present(); 
+}
+
+// I2C: START, address + W, register, repeated START, address + R, the data
+// and STOP, every byte with its ACK bit. SPI: the register and the data. 
+uint8_t AS3935EmulatorTransport::readRegisters(uint8_t _reg, uint8_t *_buf, uint8_t _len)
+{
+  _counters.reads++; 
+  uint8_t _stop = startTransfer(); 
+  if(_isSPI){
+    _counters.wireBytes += 1 + _len; 
+    spendBits(8 * (1 + _len)); 
+  }
+  else {
+    _counters.wireBytes += 3 + _len; 
+    spendBits(1 + 9 + 9 + 1 + 9 + 9 * _len + _stop); 
+  }
+  if(injectedFailure() || (!_isSPI && !_emulator->present()))
+    return 0; 
+
+  for(uint8_t i = 0; i < _len; i++)
+    _buf[i] = _emulator->readRegister(_reg + i); 
+  return _len; 
+}
+
+// I2C: START, address + W, register, the data and STOP. SPI: the register
+// and the data. 
+bool AS3935EmulatorTransport::writeRegisters(uint8_t _reg, const uint8_t *_buf, uint8_t _len)
+{
+  _counters.writes++; 
+  uint8_t _stop = startTransfer(); 
+  if(_isSPI){
+    _counters.wireBytes += 1 + _len; 
+    spendBits(8 * (1 + _len)); 
+  }
+  else {
+    _counters.wireBytes += 2 + _len; 
+    spendBits(1 + 9 + 9 + 9 * _len + _stop); 
+  }
+  if(injectedFailure() || (!_isSPI && !_emulator->present()))
+    return false; 
+
+  for(uint8_t i = 0; i < _len; i++)
+    _emulator->writeRegister(_reg + i, _buf[i]); 
+  return true; 
+}
+
+// Only the request is stored, the transfer runs in pollTransfer(). 
+bool AS3935EmulatorTransport::startRead(uint8_t _reg, uint8_t *_buf, uint8_t _len)
+{
+  if(_pending == TRANSFER_BUSY)
+    return false; 
+  _pending = TRANSFER_BUSY; 
+  _pendingWrite = false; 
+  _pendingReg = _reg; 
+  _pendingBuf = _buf; 
+  _pendingLen = _len; 
+  _dueMicros = _emulator->nowMicros() + _latencyMicros; 
+  return true; 
+}
+
+bool AS3935EmulatorTransport::startWrite(uint8_t _reg, const uint8_t *_buf, uint8_t _len)
+{
+  if(!startRead(_reg, (uint8_t *)_buf, _len))
+    return false; 
+  _pendingWrite = true; // Only ever read from in pollTransfer(). 
+  return true; 
+}
+
+transferStatus AS3935EmulatorTransport::pollTransfer()
+{
+  if( (_pending != TRANSFER_BUSY) || _stalled || ((int32_t)(_emulator->nowMicros() - _dueMicros) < 0) )
+    return _pending; 
+  bool _ok; 
+  if(_pendingWrite)
+    _ok = writeRegisters(_pendingReg, _pendingBuf, _pendingLen); 
+  else
+    _ok = (readRegisters(_pendingReg, _pendingBuf, _pendingLen) == _pendingLen); 
+  _pending = _ok ? TRANSFER_DONE : TRANSFER_FAILED; 
+  return _pending; 
+}
+
+void AS3935EmulatorTransport::abortTransfer()
+{
+  if(_pending == TRANSFER_BUSY)
+    _counters.aborts++; 
+  _pending = TRANSFER_IDLE; 
+}
+
+bool AS3935EmulatorTransport::injectedFailure()
+{
+  if(_failNext == 0)
+    return false; 
+  _failNext--; 
+  _counters.failures++; 
+  return true; 
+}
+
+void AS3935EmulatorTransport::beginSession()
+{
+  if(_sessionDepth++ == 0)
+    _counters.setups++; 
+}
+
+// I2C: the STOP held back, sent the way AS3935I2CTransport does it, with
+// START, address + W and STOP. 
+void AS3935EmulatorTransport::endSession()
+{
+  if( (_sessionDepth == 0) || (--_sessionDepth > 0) )
+    return; 
+  if(_held){
+    _counters.wireBytes += 1; 
+    spendBits(1 + 9 + 1); 
+    _held = false; 
+  }
+}
+
+uint8_t AS3935EmulatorTransport::startTransfer()
+{
+  if(_sessionDepth == 0){
+    _counters.setups++; 
+    return _isSPI ? 0 : 1; 
+  }
+  _held = !_isSPI; 
+  return 0; 
+}
+
+void AS3935EmulatorTransport::spendBits(uint32_t _bits)
+{
+  uint64_t _nanos = ((uint64_t)_bits * EMU_NS_PER_S) / _clockHz; 
+  _busNanos += _nanos; 
+  _counters.busMicros = (uint32_t)(_busNanos / EMU_NS_PER_US); 
+  _emulator->advanceNanos(_nanos); 
+}
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef _SPARKFUN_AS3935_EMULATOR_H_
+#define _SPARKFUN_AS3935_EMULATOR_H_
+
+// A software model of the AS3935 register map, for exercising the driver
+// without a board. It covers REG0x00 - REG0x08, the calibration status
+// registers REG0x3A/REG0x3B, both direct commands, the IRQ line with its 2ms
+// settling time and 1s/1.5s read windows, disturber masking, the minimum
+// number of strikes and the antenna's LCO for autoTuneAntenna(). Time is
+// simulated and only moves when the emulator is told to, or when a transport
+// spends it on the bus. Host only, not built on Arduino. 
+
+#include "SparkFun_AS3935_Core.h"
+
+class AS3935Emulator
+{
+  public:
+    AS3935Emulator(); 
+
+    // Power on: every register back to its manufacturer default and no
+    // calibration. DEFAULT_RESET does the same except for the calibration. 
+    void powerOn(); 
+
+    // Bus side. Reads have the IC's side effects, e.g. reading REG0x03
+    // clears the interrupt and lowers IRQ. Use peek() to look without them. 
+    bool present() const { return _present; }
+    uint8_t readRegister(uint8_t _reg); 
+    void writeRegister(uint8_t _reg, uint8_t _value); 
+    uint8_t peek(uint8_t _reg) const { return _regs[_reg & 0x3F]; }
+
+    // Simulated time. 
+    uint32_t nowMicros() const { return (uint32_t)(_nowNanos / 1000); }
+    uint32_t nowMillis() const { return (uint32_t)(_nowNanos / 1000000); }
+    void advanceNanos(uint64_t _nanos) { _nowNanos += _nanos; update(); }
+    void advanceMicros(uint32_t _micros) { advanceNanos((uint64_t)_micros * 1000); }
+    void advanceMillis(uint32_t _millis) { advanceNanos((uint64_t)_millis * 1000000); }
+
+    // Events, raised on the IRQ line right away and readable 2ms later.
+    // Ignored while powered down, disturbers also while masked. Lightning
+    // only interrupts once the minimum number of strikes (REG0x02 [5:4]) is
+    // reached. _strength (0 - 15) is how far a signal stands out: it has to
+    // be above the watchdog threshold (REG0x01 [3:0]) to be seen at all, and
+    // lightning also above the spike rejection (REG0x02 [3:0]). Noise is
+    // reported when its _level (0 - 7) is above the noise floor (REG0x01 [6:4]).
+    void injectLightning(uint32_t _energy, uint8_t _distance, uint8_t _strength = 15); 
+    void injectDisturber(uint8_t _strength = 15); 
+    void injectNoise(uint8_t _level = 7); 
+    bool irqLine() const { return _irq; }
+
+    // Behaviour. An absent IC does not acknowledge, a failing one reports
+    // NOK in REG0x3A/REG0x3B after calibration. The antenna resonates at
+    // _baseHz with no tuning capacitance and drops _stepHz per REG0x08 step. 
+    void setPresent(bool _state) { _present = _state; }
+    void failCalibration(bool _state) { _failCalib = _state; }
+    void setAntenna(uint32_t _baseHz, uint32_t _stepHz) { _lcoBaseHz = _baseHz; _lcoStepHz = _stepHz; }
+    uint32_t lcoFrequency() const; 
+
+    // A pulseCounter for autoTuneAntenna(): counts the IRQ edges of the
+    // divided LCO over the gate time, which it lets pass. _emulator is the
+    // AS3935Emulator. 
+    static uint32_t countPulses(uint16_t _gateMs, void *_emulator); 
+
+  private:
+    void loadDefaults(); 
+    void raise(uint8_t _interrupt); 
+    // Applies everything that happens with time: events becoming readable,
+    // read windows closing, calibration finishing. 
+    void update(); 
+
+    uint8_t _regs[0x40]; 
+    uint64_t _nowNanos; 
+    bool _present; 
+    bool _failCalib; 
+    bool _irq; 
+    uint8_t _latched;         // Interrupt waiting to become readable or be read. 
+    uint64_t _eventNanos;     // When it was raised. 
+    uint8_t _strikeCount;     // Strikes towards the minimum number. 
+    bool _calibrating; 
+    uint64_t _calibNanos;     // When the CALIB_RCO command was sent. 
+    uint32_t _lcoBaseHz; 
+    uint32_t _lcoStepHz; 
+};
+
+// Bus cost, as counted by AS3935EmulatorTransport. Wire bytes include the
+// address and register bytes, bus time is at the configured clock. 
+typedef struct AS3935_BUS_COUNTERS {
+
+  uint32_t reads;      // Read transactions. 
+  uint32_t writes;     // Write transactions. 
+  uint32_t probes;     // Address only transactions. 
+  uint32_t setups;     // Bus acquisitions: one per transaction, or one per session. 
+  uint32_t failures;   // Transactions failed by failTransfers(). 
+  uint32_t aborts;     // Non-blocking transfers given up with abortTransfer(). 
+  uint32_t wireBytes; 
+  uint32_t busMicros; 
+
+} as3935BusCounters;
+
+// A Transport that talks to an AS3935Emulator, spending simulated bus time
+// as a real I2C (or SPI) bus at _busHz would, and counting it. 
+class AS3935EmulatorTransport
+{
+  public:
+    AS3935EmulatorTransport(AS3935Emulator *_emu = NULL, uint32_t _busHz = 400000, bool _spi = false) :
+      _emulator(_emu), _clockHz(_busHz), _isSPI(_spi) { clearCounters(); }
+
+    void begin() { }
+    bool probe(); 
+    uint8_t readRegisters(uint8_t _reg, uint8_t *_buf, uint8_t _len); 
+    bool writeRegisters(uint8_t _reg, const uint8_t *_buf, uint8_t _len); 
+
+    // Every clock read costs a microsecond of CPU time, otherwise a loop that
+    // waits on the clock without touching the bus would never finish. 
+    uint32_t nowMicros() { _emulator->advanceMicros(1); return _emulator->nowMicros(); }
+    uint32_t nowMillis() { _emulator->advanceMicros(1); return _emulator->nowMillis(); }
+    void delayMs(uint16_t _ms) { _emulator->advanceMillis(_ms); }
+    void disableIrq() { }
+    void enableIrq() { }
+    void lockFromIrq() { }
+    void unlockFromIrq() { }
+    // Behaves like AS3935I2CTransport and AS3935SPITransport: one setup for
+    // the whole session, and over I2C no STOP until it ends. 
+    void beginSession(); 
+    void endSession(); 
+
+    // Non-blocking transfers. Each one finishes on the first pollTransfer()
+    // at least setLatency() microseconds after it started, by running the
+    // transfer then, so its bus time comes on top. While the bus is stalled,
+    // as by a device holding SCL low, nothing finishes. 
+    bool startRead(uint8_t _reg, uint8_t *_buf, uint8_t _len); 
+    bool startWrite(uint8_t _reg, const uint8_t *_buf, uint8_t _len); 
+    transferStatus pollTransfer(); 
+    void abortTransfer(); 
+
+    // Fault injection, for blocking and non-blocking transfers alike: the
+    // next _count transactions fail as if not acknowledged. 
+    void setLatency(uint32_t _micros) { _latencyMicros = _micros; }
+    void failTransfers(uint16_t _count) { _failNext = _count; }
+    void stallBus(bool _state) { _stalled = _state; }
+
+    AS3935Emulator *emulator() { return _emulator; }
+    const as3935BusCounters &counters() const { return _counters; }
+    void clearCounters() { memset(&_counters, 0, sizeof(_counters)); _busNanos = 0; }
+
+  private:
+    // Advances the emulator by the time _bits take on the bus. 
+    void spendBits(uint32_t _bits); 
+    // Counts the setup of one transaction. Returns the STOP bits it ends
+    // with: 1 over I2C outside a session, else 0. 
+    uint8_t startTransfer(); 
+    // Uses up one injected failure, if any is left. 
+    bool injectedFailure(); 
+
+    AS3935Emulator *_emulator; 
+    uint32_t _clockHz; 
+    bool _isSPI; 
+    uint64_t _busNanos; // Total bus time, busMicros is derived from it. 
+    uint8_t _sessionDepth = 0; 
+    bool _held = false; // I2C transfer ended without a STOP inside a session. 
+    uint32_t _latencyMicros = 0; 
+    uint16_t _failNext = 0; 
+    bool _stalled = false; 
+    // The running non-blocking transfer. 
+    transferStatus _pending = TRANSFER_IDLE; 
+    bool _pendingWrite = false; 
+    uint8_t _pendingReg = 0; 
+    uint8_t *_pendingBuf = NULL; 
+    uint8_t _pendingLen = 0; 
+    uint32_t _dueMicros = 0; 
+    as3935BusCounters _counters; 
+};
+
+typedef AS3935Driver<AS3935EmulatorTransport> SparkFun_AS3935_Emulated; 
+#endif
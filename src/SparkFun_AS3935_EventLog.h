@@ -0,0 +1,234 @@
+#ifndef _SPARKFUN_AS3935_EVENTLOG_H_
+#define _SPARKFUN_AS3935_EVENTLOG_H_
+
+#include "SparkFun_AS3935_Core.h"
+
+// Compact binary event log. Every record starts with one header byte:
+//
+//   bits [7:6]  kind: 00 control, 01 noise, 10 disturber, 11 lightning
+//   bits [5:3]  sensor id, 0 - 7
+//   bit  [2]    read after the event's read window (POLL_LATE_EVENT)
+//   bits [1:0]  lightning: energy bits [19:18]; control: 00 sync, 01 empty
+//
+// followed by the milliseconds since the previous record as a little endian
+// base 128 varint (1 byte up to 127ms, 3 bytes up to 35 minutes). Lightning
+// then adds three bytes: energy [7:0], energy [15:8], and energy [17:16] in
+// bits [7:6] with the distance in bits [5:0]. A sync record is the single
+// byte 0x00 followed by the absolute timestamp in four little endian bytes
+// instead of a delta; the encoder starts every log with one, and writes
+// another whenever time goes backwards. An "empty" control record is an
+// event whose interrupt register read 0. A lightning record takes at most
+// 9 bytes, noise and disturbers 2 - 6, against 40 - 70 characters of text.
+// The three id bits limit a log to 8 sensors. 
+#define LOG_MAX_SENSORS    8
+#define LOG_KIND_CONTROL   0x00
+#define LOG_KIND_NOISE     0x40
+#define LOG_KIND_DISTURBER 0x80
+#define LOG_KIND_LIGHTNING 0xC0
+#define LOG_LATE           0x04
+#define LOG_SYNC           0x00
+#define LOG_EMPTY          0x01
+// Longest record, plus the sync record that may precede it.
+#define LOG_MAX_RECORD     9
+#define LOG_MAX_WRITE      (LOG_MAX_RECORD + 5)
+
+// One decoded record.
+typedef struct AS3935_LOG_ENTRY {
+
+  lightningEvent event; // timestamp is absolute again.
+  uint8_t sensor;       // 0 - 7.
+  bool late;            // Read after its read window.
+
+} logEntry; 
+
+// Turns events into log records without allocating. encode() fills a caller
+// buffer of at least LOG_MAX_WRITE bytes, write() hands the bytes to any sink
+// with a write(const uint8_t *, size_t) member such as Arduino's Serial, a
+// File or a host side FILE wrapper.
+class AS3935LogEncoder
+{
+  public:
+    AS3935LogEncoder() { reset(); }
+
+    // The next record starts with a sync record again, e.g. for a new file.
+    void reset()
+    {
+      _synced = false; 
+      _lastTimestamp = 0; 
+    }
+
+    // Encodes one event for sensor _sensor. Returns the number of bytes put
+    // into _buf, 0 for an interrupt value the format has no kind for or a
+    // sensor id of LOG_MAX_SENSORS or more.
+    uint8_t encode(const lightningEvent &_event, uint8_t _sensor, bool _late, uint8_t *_buf)
+    {
+      if(_sensor >= LOG_MAX_SENSORS)
+        return 0; 
+      uint8_t _header; 
+      switch(_event.interrupt){
+        case NOISE_TO_HIGH:    _header = LOG_KIND_NOISE; break; 
+        case DISTURBER_DETECT: _header = LOG_KIND_DISTURBER; break; 
+        case LIGHTNING:        _header = LOG_KIND_LIGHTNING | ((_event.energy >> 18) & 0x03); break; 
+        case 0:                _header = LOG_KIND_CONTROL | LOG_EMPTY; break; 
+        default:               return 0; 
+      }
+      _header |= _sensor << 3; 
+      if(_late)
+        _header |= LOG_LATE; 
+
+      uint8_t _len = 0; 
+      if( !_synced || ((int32_t)(_event.timestamp - _lastTimestamp) < 0) ){
+        _buf[_len++] = LOG_SYNC; 
+        for(uint8_t i = 0; i < 4; i++)
+          _buf[_len++] = (_event.timestamp >> (8 * i)) & 0xFF; 
+        _lastTimestamp = _event.timestamp; 
+        _synced = true; 
+      }
+
+      _buf[_len++] = _header; 
+      uint32_t _delta = _event.timestamp - _lastTimestamp; 
+      _lastTimestamp = _event.timestamp; 
+      do {
+        uint8_t _byte = _delta & 0x7F; 
+        _delta >>= 7; 
+        if(_delta)
+          _byte |= 0x80; // More to come.
+        _buf[_len++] = _byte; 
+      } while(_delta); 
+
+      if( (_header & 0xC0) == LOG_KIND_LIGHTNING ){
+        _buf[_len++] = _event.energy & 0xFF; 
+        _buf[_len++] = (_event.energy >> 8) & 0xFF; 
+        _buf[_len++] = (((_event.energy >> 16) & 0x03) << 6) | (_event.distance & 0x3F); 
+      }
+      return _len; 
+    }
+
+    uint8_t encode(const AS3935EventRecord &_record, uint8_t _sensor, uint8_t *_buf)
+    {
+      lightningEvent _event; 
+      _event.interrupt = _record.type; 
+      _event.energy = _record.energy; 
+      _event.distance = _record.distance; 
+      _event.timestamp = _record.timestamp; 
+      return encode(_event, _sensor, _record.late, _buf); 
+    }
+
+    // Encodes and writes one record to _sink. Returns the bytes written.
+    template <class Sink>
+    uint8_t write(Sink &_sink, const lightningEvent &_event, uint8_t _sensor = 0, bool _late = false)
+    {
+      uint8_t _buf[LOG_MAX_WRITE]; 
+      uint8_t _len = encode(_event, _sensor, _late, _buf); 
+      if(_len)
+        _sink.write(_buf, _len); 
+      return _len; 
+    }
+
+    template <class Sink>
+    uint8_t write(Sink &_sink, const AS3935EventRecord &_record, uint8_t _sensor = 0)
+    {
+      uint8_t _buf[LOG_MAX_WRITE]; 
+      uint8_t _len = encode(_record, _sensor, _buf); 
+      if(_len)
+        _sink.write(_buf, _len); 
+      return _len; 
+    }
+
+  private:
+    bool _synced; 
+    uint32_t _lastTimestamp; 
+};
+
+// Decodes a log one byte at a time, so it can sit directly on a serial port
+// or a file read loop. Records before the first sync record are dropped.
+class AS3935LogDecoder
+{
+  public:
+    AS3935LogDecoder() { reset(); }
+
+    void reset()
+    {
+      _synced = false; 
+      _lastTimestamp = 0; 
+      _count = 0; 
+      _errors = 0; 
+    }
+
+    // Feeds one byte. Returns true when it completed a record, which is then
+    // in _entry. Sync records only set the time and return false.
+    bool push(uint8_t _byte, logEntry &_entry)
+    {
+      _buf[_count++] = _byte; 
+      uint8_t _header = _buf[0]; 
+
+      if(_header == LOG_SYNC){
+        if(_count < 5)
+          return false; 
+        _lastTimestamp = (uint32_t)_buf[1] | ((uint32_t)_buf[2] << 8) |
+          ((uint32_t)_buf[3] << 16) | ((uint32_t)_buf[4] << 24); 
+        _synced = true; 
+        _count = 0; 
+        return false; 
+      }
+
+      // Header, varint, and for lightning three more bytes.
+      uint8_t _end = 1; 
+      while( (_end < _count) && (_buf[_end] & 0x80) )
+        _end++; 
+      if(_end > 5){
+        _errors++; // Longer than any 32 bit delta: corrupt, start over.
+        _count = 0; 
+        return false; 
+      }
+      if(_end >= _count)
+        return false; // Varint not finished.
+      uint8_t _kind = _header & 0xC0; 
+      uint8_t _needed = _end + 1 + ((_kind == LOG_KIND_LIGHTNING) ? 3 : 0); 
+      if(_count < _needed)
+        return false; 
+      _count = 0; 
+
+      uint32_t _delta = 0; 
+      for(uint8_t i = _end; i >= 1; i--)
+        _delta = (_delta << 7) | (_buf[i] & 0x7F); 
+      if(!_synced)
+        return false; // No time reference yet.
+      _lastTimestamp += _delta; 
+
+      _entry.sensor = (_header >> 3) & 0x07; 
+      _entry.late = (_header & LOG_LATE) != 0; 
+      _entry.event.timestamp = _lastTimestamp; 
+      _entry.event.energy = 0; 
+      _entry.event.distance = 0; 
+      switch(_kind){
+        case LOG_KIND_NOISE:     _entry.event.interrupt = NOISE_TO_HIGH; break; 
+        case LOG_KIND_DISTURBER: _entry.event.interrupt = DISTURBER_DETECT; break; 
+        case LOG_KIND_LIGHTNING:
+          _entry.event.interrupt = LIGHTNING; 
+          _entry.event.energy = (uint32_t)_buf[_end + 1] | ((uint32_t)_buf[_end + 2] << 8) |
+            ((uint32_t)(_buf[_end + 3] >> 6) << 16) | ((uint32_t)(_header & 0x03) << 18); 
+          _entry.event.distance = _buf[_end + 3] & 0x3F; 
+          break; 
+        default:
+          if( (_header & 0x03) != LOG_EMPTY ){
+            _errors++; // Reserved control record.
+            return false; 
+          }
+          _entry.event.interrupt = 0; 
+          break; 
+      }
+      return true; 
+    }
+
+    // Bytes that could not be part of a valid record.
+    uint32_t errors() const { return _errors; }
+
+  private:
+    uint8_t _buf[LOG_MAX_RECORD]; 
+    uint8_t _count; 
+    bool _synced; 
+    uint32_t _lastTimestamp; 
+    uint32_t _errors; 
+};
+#endif
@@ -0,0 +1,102 @@
+#ifndef _SPARKFUN_AS3935_EVENTQUEUE_H_
+#define _SPARKFUN_AS3935_EVENTQUEUE_H_
+
+#include <stdint.h>
+
+// Compiler and CPU barrier between filling a slot and publishing its index.
+// On single core MCUs this only stops the compiler from reordering. 
+#define AS3935_QUEUE_BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+// One detected event packed into eight bytes. 
+struct AS3935EventRecord {
+
+  uint32_t timestamp;     // millis() at the IRQ edge.
+  uint32_t energy   : 20; // REG0x04 - REG0x06, 20 bit 'energy' of the strike.
+  uint32_t type     : 4;  // REG0x03, bits [3:0], one of INTERRUPT_STATUS.
+  uint32_t distance : 6;  // REG0x07, bits [5:0], distance to the storm in km.
+  uint32_t late     : 1;  // Read after the event's read window. 
+
+  // Builds a record from anything with the fields of lightningEvent. 
+  template <typename Event>
+  static AS3935EventRecord fromEvent(const Event &_event, bool _late)
+  {
+    AS3935EventRecord _record; 
+    _record.timestamp = _event.timestamp; 
+    _record.energy = _event.energy; 
+    _record.type = _event.interrupt; 
+    _record.distance = _event.distance; 
+    _record.late = _late; 
+    return _record; 
+  }
+
+};
+
+// A fixed capacity, allocation free ring buffer of event records for exactly
+// one producer (the library's event capture, poll() from the loop or an RTOS
+// task) and one consumer (the application, possibly in another task).
+// Neither side takes a lock: the producer only writes _head and the consumer
+// only writes _tail. poll() reads the IC over the bus, so it must not be
+// called from an ISR; the IRQ pin's ISR only calls notifyIrq(). 
+// N is the number of records the queue can hold, up to 254. 
+template <uint8_t N>
+class AS3935EventQueue
+{
+  public:
+    // Adds a record. If the queue is full the record is dropped, the overflow
+    // counter is incremented and false is returned. Producer side only. 
+    bool push(const AS3935EventRecord &_record)
+    {
+      uint8_t _next = advance(_head); 
+      if(_next == _tail){
+        _overflows++; 
+        return false; 
+      }
+      _slots[_head] = _record; 
+      AS3935_QUEUE_BARRIER(); // Slot must be written before it is published.
+      _head = _next; 
+      return true; 
+    }
+
+    // Takes the oldest record. Returns false if the queue is empty. Consumer
+    // side only. 
+    bool pop(AS3935EventRecord &_record)
+    {
+      uint8_t _current = _tail; 
+      if(_current == _head)
+        return false; 
+      AS3935_QUEUE_BARRIER(); // Slot must be read after _head was seen.
+      _record = _slots[_current]; 
+      AS3935_QUEUE_BARRIER(); // Slot must be read before it is handed back.
+      _tail = advance(_current); 
+      return true; 
+    }
+
+    // Number of records waiting. Exact for the consumer, a lower bound for
+    // the producer. 
+    uint8_t size() const
+    {
+      uint8_t _h = _head; 
+      uint8_t _t = _tail; 
+      return (_h >= _t) ? (_h - _t) : (N + 1 - _t + _h); 
+    }
+
+    bool empty() const { return _head == _tail; }
+    uint8_t capacity() const { return N; }
+
+    // Records dropped because the queue was full. 
+    uint16_t overflowCount() const { return _overflows; }
+
+  private:
+
+    static_assert((N > 0) && (N < 255), "AS3935EventQueue holds 1 to 254 records");
+
+    // One slot is always left empty so that full and empty can be told apart.
+    static uint8_t advance(uint8_t _index) { return (_index >= N) ? 0 : (_index + 1); }
+
+    AS3935EventRecord _slots[N + 1]; 
+    volatile uint8_t _head = 0; // Next slot to write, owned by the producer.
+    volatile uint8_t _tail = 0; // Next slot to read, owned by the consumer.
+    volatile uint16_t _overflows = 0; // Owned by the producer.
+
+};
+#endif
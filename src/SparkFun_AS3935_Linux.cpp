@@ -0,0 +1,274 @@
+/*
+  Linux userspace transports for the ASM AS3935 Franklin Lightning Detector.
+  See SparkFun_AS3935_Linux.h.
+*/
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include "SparkFun_AS3935_Linux.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <linux/spi/spidev.h>
+
+// Longest burst the driver asks for, REG0x00 - REG0x08. 
+#define LINUX_MAX_BURST 16
+
+static int systemOpen(const char *_path, int _flags) { return ::open(_path, _flags); }
+static int systemIoctl(int _fd, unsigned long _request, void *_arg) { return ::ioctl(_fd, _request, _arg); }
+static int systemClose(int _fd) { return ::close(_fd); }
+
+const as3935LinuxIo &as3935SystemIo()
+{
+  static const as3935LinuxIo _system = { systemOpen, systemIoctl, systemClose }; 
+  return _system; 
+}
+
+uint32_t AS3935LinuxPlatform::nowMicros()
+{
+  struct timespec _now; 
+  clock_gettime(CLOCK_MONOTONIC, &_now); 
+  return (uint32_t)((uint64_t)_now.tv_sec * 1000000ULL + _now.tv_nsec / 1000); 
+}
+
+uint32_t AS3935LinuxPlatform::nowMillis()
+{
+  struct timespec _now; 
+  clock_gettime(CLOCK_MONOTONIC, &_now); 
+  return (uint32_t)((uint64_t)_now.tv_sec * 1000ULL + _now.tv_nsec / 1000000); 
+}
+
+void AS3935LinuxPlatform::delayMs(uint16_t _ms)
+{
+  struct timespec _wait; 
+  _wait.tv_sec = _ms / 1000; 
+  _wait.tv_nsec = (long)(_ms % 1000) * 1000000L; 
+  while(nanosleep(&_wait, &_wait) != 0) ; // Resume after signals. 
+}
+
+AS3935LinuxI2CTransport::AS3935LinuxI2CTransport(const char *_devicePath, i2cAddress _deviceAddress, const as3935LinuxIo &_sysIo) :
+  _path(_devicePath), _address(_deviceAddress), _io(&_sysIo), _fd(-1), _timeoutUs(TRANSFER_TIMEOUT_US) { }
+
+AS3935LinuxI2CTransport::AS3935LinuxI2CTransport(const AS3935LinuxI2CTransport &_other) :
+  AS3935LinuxPlatform(), _path(_other._path), _address(_other._address), _io(_other._io), _fd(-1),
+  _timeoutUs(_other._timeoutUs) { }
+
+AS3935LinuxI2CTransport &AS3935LinuxI2CTransport::operator=(const AS3935LinuxI2CTransport &_other)
+{
+  if(this != &_other){
+    end(); 
+    _path = _other._path; 
+    _address = _other._address; 
+    _io = _other._io; 
+    _timeoutUs = _other._timeoutUs; 
+  }
+  return *this; 
+}
+
+AS3935LinuxI2CTransport::~AS3935LinuxI2CTransport() { end(); }
+
+// An adapter that rejects the timeout keeps its own, the device stays open. 
+void AS3935LinuxI2CTransport::begin()
+{
+  if(_fd < 0)
+    _fd = _io->openDevice(_path, O_RDWR); 
+  if(_fd < 0)
+    return; 
+  unsigned long _ticks = (_timeoutUs + 9999UL) / 10000UL; // 10ms steps.
+  _io->ioctlDevice(_fd, I2C_TIMEOUT, (void *)(_ticks > 0 ? _ticks : 1UL)); 
+}
+
+void AS3935LinuxI2CTransport::end()
+{
+  if(_fd >= 0)
+    _io->closeDevice(_fd); 
+  _fd = -1; 
+}
+
+// Reads REG0x00, the IC only acknowledges its own address. 
+bool AS3935LinuxI2CTransport::probe()
+{
+  uint8_t _value; 
+  return (readRegisters(AFE_GAIN, &_value, 1) == 1); 
+}
+
+uint8_t AS3935LinuxI2CTransport::readRegisters(uint8_t _reg, uint8_t *_buf, uint8_t _len)
+{
+  if(_fd < 0)
+    return 0; 
+
+  struct i2c_msg _msgs[2]; 
+  _msgs[0].addr = _address; 
+  _msgs[0].flags = 0; 
+  _msgs[0].len = 1; 
+  _msgs[0].buf = &_reg; // Moves pointer to the first register.
+  _msgs[1].addr = _address; 
+  _msgs[1].flags = I2C_M_RD; // Repeated start, then read.
+  _msgs[1].len = _len; 
+  _msgs[1].buf = _buf; 
+
+  struct i2c_rdwr_ioctl_data _transfer; 
+  _transfer.msgs = _msgs; 
+  _transfer.nmsgs = 2; 
+  if(_io->ioctlDevice(_fd, I2C_RDWR, &_transfer) < 0)
+    return 0; 
+  return _len; 
+}
+
+bool AS3935LinuxI2CTransport::writeRegisters(uint8_t _reg, const uint8_t *_buf, uint8_t _len)
+{
+  if( (_fd < 0) || (_len >= LINUX_MAX_BURST) )
+    return false; 
+
+  uint8_t _out[LINUX_MAX_BURST]; 
+  _out[0] = _reg; 
+  memcpy(&_out[1], _buf, _len); 
+
+  struct i2c_msg _msg; 
+  _msg.addr = _address; 
+  _msg.flags = 0; 
+  _msg.len = _len + 1; 
+  _msg.buf = _out; 
+
+  struct i2c_rdwr_ioctl_data _transfer; 
+  _transfer.msgs = &_msg; 
+  _transfer.nmsgs = 1; 
+  return (_io->ioctlDevice(_fd, I2C_RDWR, &_transfer) >= 0); 
+}
+
+// The adapter fails a transfer it gave up on with ETIMEDOUT. 
+bool AS3935LinuxI2CTransport::startRead(uint8_t _reg, uint8_t *_buf, uint8_t _len)
+{
+  errno = 0; 
+  if(readRegisters(_reg, _buf, _len) == _len)
+    _transferStatus = TRANSFER_DONE; 
+  else
+    _transferStatus = (errno == ETIMEDOUT) ? TRANSFER_TIMEOUT : TRANSFER_FAILED; 
+  return true; 
+}
+
+bool AS3935LinuxI2CTransport::startWrite(uint8_t _reg, const uint8_t *_buf, uint8_t _len)
+{
+  errno = 0; 
+  if(writeRegisters(_reg, _buf, _len))
+    _transferStatus = TRANSFER_DONE; 
+  else
+    _transferStatus = (errno == ETIMEDOUT) ? TRANSFER_TIMEOUT : TRANSFER_FAILED; 
+  return true; 
+}
+
+AS3935LinuxSPITransport::AS3935LinuxSPITransport(const char *_devicePath, uint32_t _portSpeed, const as3935LinuxIo &_sysIo) :
+  _path(_devicePath), _spiPortSpeed(_portSpeed), _io(&_sysIo), _fd(-1) { }
+
+AS3935LinuxSPITransport::AS3935LinuxSPITransport(const AS3935LinuxSPITransport &_other) :
+  AS3935LinuxPlatform(), _path(_other._path), _spiPortSpeed(_other._spiPortSpeed), _io(_other._io), _fd(-1) { }
+
+AS3935LinuxSPITransport &AS3935LinuxSPITransport::operator=(const AS3935LinuxSPITransport &_other)
+{
+  if(this != &_other){
+    end(); 
+    _path = _other._path; 
+    _spiPortSpeed = _other._spiPortSpeed; 
+    _io = _other._io; 
+  }
+  return *this; 
+}
+
+AS3935LinuxSPITransport::~AS3935LinuxSPITransport() { end(); }
+
+// Opens the device in SPI mode 1, MSB first. Make sure the port speed is not
+// 500kHz or it will cause feedback with the antenna. 
+void AS3935LinuxSPITransport::begin()
+{
+  if(_fd >= 0)
+    return; 
+  _fd = _io->openDevice(_path, O_RDWR); 
+  if(_fd < 0)
+    return; 
+
+  uint8_t _mode = SPI_MODE_1; 
+  uint8_t _bits = 8; 
+  if( (_io->ioctlDevice(_fd, SPI_IOC_WR_MODE, &_mode) < 0) ||
+      (_io->ioctlDevice(_fd, SPI_IOC_WR_BITS_PER_WORD, &_bits) < 0) ||
+      (_io->ioctlDevice(_fd, SPI_IOC_WR_MAX_SPEED_HZ, &_spiPortSpeed) < 0) )
+    end(); 
+}
+
+void AS3935LinuxSPITransport::end()
+{
+  if(_fd >= 0)
+    _io->closeDevice(_fd); 
+  _fd = -1; 
+}
+
+bool AS3935LinuxSPITransport::probe()
+{
+  return (_fd >= 0); 
+}
+
+uint8_t AS3935LinuxSPITransport::readRegisters(uint8_t _reg, uint8_t *_buf, uint8_t _len)
+{
+  if( (_fd < 0) || (_len >= LINUX_MAX_BURST) )
+    return 0; 
+
+  uint8_t _out[LINUX_MAX_BURST] = { 0 }; 
+  uint8_t _in[LINUX_MAX_BURST]; 
+  _out[0] = _reg | SPI_READ_M; // Register OR'ed with SPI read command. 
+
+  struct spi_ioc_transfer _xfer[2]; 
+  memset(_xfer, 0, sizeof(_xfer)); 
+  _xfer[0].tx_buf = (unsigned long)_out; 
+  _xfer[0].rx_buf = (unsigned long)_in; 
+  _xfer[0].len = _len + 1; 
+  _xfer[0].speed_hz = _spiPortSpeed; 
+  _xfer[0].bits_per_word = 8; 
+  _xfer[0].cs_change = 1; // Chip select HIGH, then LOW again for _xfer[1].
+  _xfer[1].speed_hz = _spiPortSpeed; // Empty, chip select HIGH at the end.
+  _xfer[1].bits_per_word = 8; 
+
+  if(_io->ioctlDevice(_fd, SPI_IOC_MESSAGE(2), _xfer) < 0)
+    return 0; 
+  memcpy(_buf, &_in[1], _len); 
+  return _len; 
+}
+
+bool AS3935LinuxSPITransport::writeRegisters(uint8_t _reg, const uint8_t *_buf, uint8_t _len)
+{
+  if( (_fd < 0) || (_len >= LINUX_MAX_BURST) )
+    return false; 
+
+  uint8_t _out[LINUX_MAX_BURST]; 
+  _out[0] = _reg; // Start write command at given register
+  memcpy(&_out[1], _buf, _len); 
+
+  struct spi_ioc_transfer _xfer; 
+  memset(&_xfer, 0, sizeof(_xfer)); 
+  _xfer.tx_buf = (unsigned long)_out; 
+  _xfer.len = _len + 1; 
+  _xfer.speed_hz = _spiPortSpeed; 
+  _xfer.bits_per_word = 8; 
+  return (_io->ioctlDevice(_fd, SPI_IOC_MESSAGE(1), &_xfer) >= 0); 
+}
+
+bool AS3935LinuxSPITransport::startRead(uint8_t _reg, uint8_t *_buf, uint8_t _len)
+{
+  _transferStatus = (readRegisters(_reg, _buf, _len) == _len) ? TRANSFER_DONE : TRANSFER_FAILED; 
+  return true; 
+}
+
+bool AS3935LinuxSPITransport::startWrite(uint8_t _reg, const uint8_t *_buf, uint8_t _len)
+{
+  _transferStatus = writeRegisters(_reg, _buf, _len) ? TRANSFER_DONE : TRANSFER_FAILED; 
+  return true; 
+}
+
+// Build the drivers once here, so the library carries them ready to link. 
+template class AS3935Driver<AS3935LinuxI2CTransport>; 
+template class AS3935Driver<AS3935LinuxSPITransport>; 
+
+#endif
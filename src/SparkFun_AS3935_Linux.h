@@ -0,0 +1,117 @@
+#ifndef _SPARKFUN_AS3935_LINUX_H_
+#define _SPARKFUN_AS3935_LINUX_H_
+
+// Transports for running AS3935Driver in Linux userspace, through i2c-dev
+// (/dev/i2c-N) or spidev (/dev/spidevX.Y). Not used on Arduino. 
+
+#include "SparkFun_AS3935_Core.h"
+
+// The system calls the Linux transports make. They default to the real ones,
+// and can be pointed at an in-process stand-in to run without hardware. 
+typedef struct AS3935_LINUX_IO {
+
+  int (*openDevice)(const char *_path, int _flags);
+  int (*ioctlDevice)(int _fd, unsigned long _request, void *_arg);
+  int (*closeDevice)(int _fd);
+
+} as3935LinuxIo;
+
+// The real open(), ioctl() and close(). 
+const as3935LinuxIo &as3935SystemIo();
+
+// Monotonic clock, sleeping and a spin lock in place of disabling
+// interrupts, as notifyIrq() will usually be called from a GPIO thread. The
+// thread takes the same lock, so poll() never sees half an update. 
+class AS3935LinuxPlatform
+{
+  public:
+    uint32_t nowMicros(); 
+    uint32_t nowMillis(); 
+    void delayMs(uint16_t _ms); 
+    void disableIrq() { while(__atomic_test_and_set(&_irqLock, __ATOMIC_ACQUIRE)) ; }
+    void enableIrq() { __atomic_clear(&_irqLock, __ATOMIC_RELEASE); }
+    void lockFromIrq() { disableIrq(); }
+    void unlockFromIrq() { enableIrq(); }
+    // Every burst is already one ioctl under the kernel's adapter lock, and
+    // i2c-dev and spidev can not hold the bus between ioctls, so a session
+    // changes nothing here. 
+    void beginSession() { }
+    void endSession() { }
+    // The ioctls block, so startRead() and startWrite() run the transfer to
+    // the end and this reports how it went. An I2C one is bounded by the
+    // adapter timeout, an SPI one by the clock. 
+    transferStatus pollTransfer() { return _transferStatus; }
+    void abortTransfer() { _transferStatus = TRANSFER_IDLE; }
+
+  protected:
+    transferStatus _transferStatus = TRANSFER_IDLE; 
+
+  private:
+    bool _irqLock = false; 
+};
+
+// I-squared-C through /dev/i2c-N. Every burst is a single I2C_RDWR ioctl: a
+// read is the register address write and the data read joined by a repeated
+// start, a write is one message of the address followed by the data. The
+// device is opened in begin() and closed when the transport is destroyed. 
+// Copies never share the open device. begin() also sets the adapter
+// timeout (I2C_TIMEOUT), which applies to every user of the bus; a transfer
+// the adapter gave up on ends with TRANSFER_TIMEOUT. 
+class AS3935LinuxI2CTransport : public AS3935LinuxPlatform
+{
+  public:
+    AS3935LinuxI2CTransport(const char *_devicePath = "/dev/i2c-1", i2cAddress _deviceAddress = AS3935_DEFAULT_ADDRESS, const as3935LinuxIo &_sysIo = as3935SystemIo()); 
+    AS3935LinuxI2CTransport(const AS3935LinuxI2CTransport &_other); 
+    AS3935LinuxI2CTransport &operator=(const AS3935LinuxI2CTransport &_other); 
+    ~AS3935LinuxI2CTransport(); 
+
+    void begin(); 
+    bool probe(); 
+    uint8_t readRegisters(uint8_t _reg, uint8_t *_buf, uint8_t _len); 
+    bool writeRegisters(uint8_t _reg, const uint8_t *_buf, uint8_t _len); 
+    bool startRead(uint8_t _reg, uint8_t *_buf, uint8_t _len); 
+    bool startWrite(uint8_t _reg, const uint8_t *_buf, uint8_t _len); 
+    // Rounded up to the kernel's 10ms steps, applied by the next begin(). 
+    void setTransferTimeout(uint32_t _micros) { _timeoutUs = _micros; }
+    // Closes the device, begin() opens it again. 
+    void end(); 
+
+  private:
+    const char *_path; 
+    i2cAddress _address; 
+    const as3935LinuxIo *_io; 
+    int _fd; 
+    uint32_t _timeoutUs; 
+};
+
+// SPI through /dev/spidevX.Y in mode 1. Every burst is a single
+// SPI_IOC_MESSAGE ioctl. Reads carry a second, empty transfer after the data
+// so that chip select goes HIGH, LOW, HIGH as the datasheet requires to end a
+// READ command. 
+class AS3935LinuxSPITransport : public AS3935LinuxPlatform
+{
+  public:
+    AS3935LinuxSPITransport(const char *_devicePath = "/dev/spidev0.0", uint32_t _portSpeed = 2000000, const as3935LinuxIo &_sysIo = as3935SystemIo()); 
+    AS3935LinuxSPITransport(const AS3935LinuxSPITransport &_other); 
+    AS3935LinuxSPITransport &operator=(const AS3935LinuxSPITransport &_other); 
+    ~AS3935LinuxSPITransport(); 
+
+    void begin(); 
+    // SPI has no acknowledge, so this only checks that the device is open. 
+    bool probe(); 
+    uint8_t readRegisters(uint8_t _reg, uint8_t *_buf, uint8_t _len); 
+    bool writeRegisters(uint8_t _reg, const uint8_t *_buf, uint8_t _len); 
+    bool startRead(uint8_t _reg, uint8_t *_buf, uint8_t _len); 
+    bool startWrite(uint8_t _reg, const uint8_t *_buf, uint8_t _len); 
+    void end(); 
+
+  private:
+    const char *_path; 
+    uint32_t _spiPortSpeed; 
+    const as3935LinuxIo *_io; 
+    int _fd; 
+};
+
+typedef AS3935Driver<AS3935LinuxI2CTransport> SparkFun_AS3935_LinuxI2C; 
+typedef AS3935Driver<AS3935LinuxSPITransport> SparkFun_AS3935_LinuxSPI; 
+#endif
@@ -0,0 +1,141 @@
+#ifndef _SPARKFUN_AS3935_MANAGER_H_
+#define _SPARKFUN_AS3935_MANAGER_H_
+
+#include "SparkFun_AS3935_Core.h"
+
+// Defined in SparkFun_AS3935.h, include that first on Arduino. 
+class SparkFun_AS3935; 
+
+// How much sooner each priority step makes a detector's read window close
+// when service() orders the reads. 
+#define MANAGER_PRIORITY_STEP_US 50000UL
+
+// Called by AS3935Manager::service() for every event it reads. _sensor is the
+// index returned by addSensor(). 
+typedef void (*managerEventHandler)(uint8_t _sensor, const lightningEvent &_event, pollStatus _status, void *_context);
+
+// Per sensor bookkeeping, latency is from the IRQ edge to the register read. 
+typedef struct AS3935_SENSOR_STATS {
+
+  uint32_t events;        // Events read. 
+  uint32_t lateEvents;    // Events read after their read window. 
+  uint32_t busErrors;     // Event reads that failed, service() tries again. 
+  uint32_t lastLatencyUs; // Latency of the most recent event. 
+  uint32_t maxLatencyUs;  // Worst latency seen. 
+
+} sensorStats;
+
+// Services up to N detectors, on any mix of I2C addresses and SPI chip
+// selects, from one loop. Each detector's ISR calls notifyIrq() (on the
+// sensor or through the manager), and service() then reads every detector
+// whose 2ms settling time has passed, the one with the least time left in
+// its 1s read window first. Each priority step takes
+// MANAGER_PRIORITY_STEP_US off that time, so a higher priority detector goes
+// ahead of edges up to that much older per step. One service() call does at
+// most N burst reads, so its worst case time is bounded by N times one event
+// read, far below the read window. Sensor is any AS3935Driver, or the
+// SparkFun_AS3935 wrapper by default. 
+template <uint8_t N, class Sensor = SparkFun_AS3935>
+class AS3935Manager
+{
+  public:
+    AS3935Manager(managerEventHandler _handler = NULL, void *_context = NULL) :
+      _eventHandler(_handler), _handlerContext(_context) { }
+
+    // Adds a detector that has already been started. Higher priorities are
+    // read first unless an older edge is running out of its read window, see
+    // MANAGER_PRIORITY_STEP_US. Returns its index, or -1 when full. 
+    int8_t addSensor(Sensor &_sensor, uint8_t _priority = 0)
+    {
+      if(_count >= N)
+        return -1; 
+      _sensors[_count] = &_sensor; 
+      _priorities[_count] = _priority; 
+      memset(&_stats[_count], 0, sizeof(sensorStats)); 
+      return _count++; 
+    }
+
+    // Safe to call from the ISR attached to that detector's IRQ pin. 
+    void notifyIrq(uint8_t _sensor)
+    {
+      if(_sensor < _count)
+        _sensors[_sensor]->notifyIrq(); 
+    }
+
+    // Reads every detector that has an event ready, most urgent first, and
+    // hands each event to the handler. Returns the number of events read. 
+    uint8_t service()
+    {
+      uint8_t _order[N]; 
+      int32_t _slack[N]; 
+      uint8_t _ready = 0; 
+
+      // Insertion sort of the ready detectors by time left, least first. 
+      for(uint8_t i = 0; i < _count; i++){
+        if(!_sensors[i]->irqPending())
+          continue; 
+        uint32_t _thisAge = _sensors[i]->irqAge(); 
+        if(_thisAge < IRQ_SETTLE_US)
+          continue; 
+        int32_t _thisSlack = slack(i, _thisAge); 
+        uint8_t j = _ready++; 
+        while( (j > 0) && (_thisSlack < _slack[j - 1]) ){
+          _order[j] = _order[j - 1]; 
+          _slack[j] = _slack[j - 1]; 
+          j--; 
+        }
+        _order[j] = i; 
+        _slack[j] = _thisSlack; 
+      }
+
+      // Read them back to back. 
+      uint8_t _serviced = 0; 
+      for(uint8_t k = 0; k < _ready; k++){
+        uint8_t i = _order[k]; 
+        uint32_t _latency = _sensors[i]->irqAge(); 
+        lightningEvent _event; 
+        pollStatus _status = _sensors[i]->poll(_event); 
+        if(_status == POLL_BUS_ERROR)
+          _stats[i].busErrors++; 
+        if( (_status != POLL_EVENT) && (_status != POLL_LATE_EVENT) )
+          continue; 
+
+        _stats[i].events++; 
+        if(_status == POLL_LATE_EVENT)
+          _stats[i].lateEvents++; 
+        _stats[i].lastLatencyUs = _latency; 
+        if(_latency > _stats[i].maxLatencyUs)
+          _stats[i].maxLatencyUs = _latency; 
+        _serviced++; 
+
+        if(_eventHandler != NULL)
+          _eventHandler(i, _event, _status, _handlerContext); 
+      }
+      return _serviced; 
+    }
+
+    uint8_t sensorCount() const { return _count; }
+    Sensor &sensor(uint8_t _sensor) { return *_sensors[_sensor]; }
+    const sensorStats &stats(uint8_t _sensor) const { return _stats[_sensor]; }
+
+  private:
+
+    // Microseconds left until the lightning read window of an edge _age old
+    // closes, less the detector's priority steps. Below zero once it is late,
+    // every late edge counting the same. 
+    int32_t slack(uint8_t _sensor, uint32_t _age) const
+    {
+      if(_age > DISTURBER_WINDOW_US)
+        _age = DISTURBER_WINDOW_US; 
+      return (int32_t)LIGHTNING_WINDOW_US - (int32_t)_age - (int32_t)(_priorities[_sensor] * MANAGER_PRIORITY_STEP_US); 
+    }
+
+    managerEventHandler _eventHandler; 
+    void *_handlerContext; 
+    Sensor *_sensors[N]; 
+    uint8_t _priorities[N]; 
+    sensorStats _stats[N]; 
+    uint8_t _count = 0; 
+
+};
+#endif
@@ -0,0 +1,270 @@
+#ifndef _SPARKFUN_AS3935_STORMTRACKER_H_
+#define _SPARKFUN_AS3935_STORMTRACKER_H_
+
+#include "SparkFun_AS3935_Core.h"
+
+// Number of log2 energy bins. Bin 0 holds energies under 32, bin k the ones
+// from 2^(k+4) up to 2^(k+5), so the last bin ends at the 20 bit maximum.
+#define STORM_ENERGY_BINS 16
+// REG0x07 reports 0x3F when the storm is out of range.
+#define STORM_OUT_OF_RANGE 0x3F
+// Distance change, in km per hour, below which a storm counts as steady.
+#define STORM_STEADY_KMH 2
+
+typedef enum SF_AS3935_STORM_TREND {
+
+  TREND_UNKNOWN     = 0, // Fewer than two periods with a distance.
+  TREND_APPROACHING,
+  TREND_STEADY,
+  TREND_RECEDING
+
+} stormTrend; 
+
+// Sliding window statistics of the strikes of a storm, in constant memory and
+// without floating point. The window is B periods of _periodMs each; a strike
+// updates the running totals of the newest period in constant time, and as
+// time moves on the oldest period is dropped from them. Energies are kept as
+// a log2 histogram per period, which answers percentiles to within their bin.
+// Each period takes 25 bytes on an AVR: the default 6 periods of 2.5 minutes
+// cover the last 15 minutes in 150 bytes plus the totals. Only lightning is
+// counted, other events are ignored.
+template <uint8_t B = 6>
+class AS3935StormTracker
+{
+  public:
+    explicit AS3935StormTracker(uint32_t _periodMs = 150000UL) : _period(_periodMs)
+    {
+      static_assert(B >= 2, "The storm tracker needs at least two periods."); 
+      clear(); 
+    }
+
+    // Forgets every strike.
+    void clear()
+    {
+      memset(_buckets, 0, sizeof(_buckets)); 
+      memset(_energyTotal, 0, sizeof(_energyTotal)); 
+      _strikeTotal = 0; 
+      _newest = 0; 
+      _started = false; 
+      for(uint8_t i = 0; i < B; i++)
+        _buckets[i].closest = STORM_OUT_OF_RANGE; 
+    }
+
+    // Moves the window up to _nowMs (millis()), dropping the periods that
+    // fell out of it. Call it before reading the statistics when no strike
+    // has come in for a while.
+    void update(uint32_t _nowMs)
+    {
+      if(!_started){
+        _periodStart = _nowMs; 
+        _started = true; 
+        return; 
+      }
+      if((int32_t)(_nowMs - _periodStart) < 0)
+        return; // An older event read late, it goes into the newest period.
+      uint8_t _steps = 0; 
+      while( ((_nowMs - _periodStart) >= _period) && (_steps < B) ){
+        _newest = (_newest + 1) % B; 
+        dropBucket(_newest); 
+        _periodStart += _period; 
+        _steps++; 
+      }
+      if((_nowMs - _periodStart) >= _period) // Quiet for longer than the window.
+        _periodStart = _nowMs; 
+    }
+
+    // Adds an event, anything but lightning is ignored.
+    void add(const lightningEvent &_event)
+    {
+      if(_event.interrupt == LIGHTNING)
+        addStrike(_event.timestamp, _event.energy, _event.distance); 
+    }
+
+    void add(const AS3935EventRecord &_record)
+    {
+      if(_record.type == LIGHTNING)
+        addStrike(_record.timestamp, _record.energy, _record.distance); 
+    }
+
+    // Adds one strike at _timestampMs (millis()).
+    void addStrike(uint32_t _timestampMs, uint32_t _energy, uint8_t _distance)
+    {
+      update(_timestampMs); 
+      stormBucket &_bucket = _buckets[_newest]; 
+      if(_bucket.strikes == 0xFFFF)
+        return; // Saturated, keep the totals consistent with the periods.
+      _bucket.strikes++; 
+      _strikeTotal++; 
+
+      uint8_t _bin = energyBin(_energy); 
+      if(_bucket.energy[_bin] < 0xFF){
+        _bucket.energy[_bin]++; 
+        _energyTotal[_bin]++; 
+      }
+
+      if(_distance < STORM_OUT_OF_RANGE){
+        _bucket.ranged++; 
+        _bucket.distanceSum += _distance; 
+        if(_distance < _bucket.closest)
+          _bucket.closest = _distance; 
+      }
+    }
+
+    // Strikes in the window.
+    uint32_t strikes() const { return _strikeTotal; }
+
+    // Strikes in the window scaled to one hour.
+    uint32_t strikesPerHour() const
+    {
+      uint32_t _windowSeconds = windowMs() / 1000; 
+      if(_windowSeconds == 0)
+        return 0; 
+      return (_strikeTotal * 3600UL) / _windowSeconds; 
+    }
+
+    // Closest and mean distance in km, STORM_OUT_OF_RANGE if none in range.
+    uint8_t closestDistance() const
+    {
+      uint8_t _closest = STORM_OUT_OF_RANGE; 
+      for(uint8_t i = 0; i < B; i++){
+        if(_buckets[i].closest < _closest)
+          _closest = _buckets[i].closest; 
+      }
+      return _closest; 
+    }
+
+    uint8_t meanDistance() const
+    {
+      uint32_t _sum = 0; 
+      uint32_t _ranged = 0; 
+      for(uint8_t i = 0; i < B; i++){
+        _sum += _buckets[i].distanceSum; 
+        _ranged += _buckets[i].ranged; 
+      }
+      if(_ranged == 0)
+        return STORM_OUT_OF_RANGE; 
+      return (_sum + _ranged / 2) / _ranged; 
+    }
+
+    // The energy below which _percent percent of the strikes in the window
+    // fall, interpolated inside its log2 bin. 0 without strikes.
+    uint32_t energyPercentile(uint8_t _percent) const
+    {
+      uint32_t _counted = 0; 
+      for(uint8_t k = 0; k < STORM_ENERGY_BINS; k++)
+        _counted += _energyTotal[k]; 
+      if(_counted == 0)
+        return 0; 
+      if(_percent > 100)
+        _percent = 100; 
+
+      uint32_t _rank = (_counted * _percent + 99) / 100; // 1 based
+      if(_rank == 0)
+        _rank = 1; 
+      uint32_t _below = 0; 
+      for(uint8_t k = 0; k < STORM_ENERGY_BINS; k++){
+        uint16_t _inBin = _energyTotal[k]; 
+        if(_below + _inBin >= _rank){
+          uint32_t _low = (k == 0) ? 0 : (1UL << (k + 4)); 
+          uint32_t _width = (k == 0) ? 32 : _low; 
+          return _low + (_width * (_rank - _below) - 1) / _inBin; 
+        }
+        _below += _inBin; 
+      }
+      return 0xFFFFF; 
+    }
+
+    // How fast the storm front moves, in km per hour: negative while it
+    // approaches. A least squares fit of the mean distance of each period
+    // against time, weighted by its number of strikes. 0 when unknown.
+    int16_t trend() const
+    {
+      int64_t _w = 0, _wt = 0, _wd = 0, _wtt = 0, _wtd = 0; 
+      uint8_t _periods = 0; 
+      for(uint8_t t = 0; t < B; t++){
+        // t = 0 is the oldest period.
+        const stormBucket &_bucket = _buckets[(_newest + 1 + t) % B]; 
+        if(_bucket.ranged == 0)
+          continue; 
+        int64_t _weight = _bucket.ranged; 
+        _w += _weight; 
+        _wt += _weight * t; 
+        _wd += _bucket.distanceSum; // Weight times the period's mean.
+        _wtt += _weight * t * t; 
+        _wtd += (int64_t)_bucket.distanceSum * t; 
+        _periods++; 
+      }
+      int64_t _denominator = _w * _wtt - _wt * _wt; 
+      if( (_periods < 2) || (_denominator == 0) )
+        return 0; 
+      // Slope in m per period, then km per hour.
+      int64_t _metres = ((_w * _wtd - _wt * _wd) * 1000) / _denominator; 
+      return (int16_t)((_metres * 3600) / (int64_t)_period); 
+    }
+
+    stormTrend trendDirection() const
+    {
+      uint8_t _periods = 0; 
+      for(uint8_t i = 0; i < B; i++){
+        if(_buckets[i].ranged)
+          _periods++; 
+      }
+      if(_periods < 2)
+        return TREND_UNKNOWN; 
+      int16_t _kmh = trend(); 
+      if(_kmh <= -STORM_STEADY_KMH)
+        return TREND_APPROACHING; 
+      if(_kmh >= STORM_STEADY_KMH)
+        return TREND_RECEDING; 
+      return TREND_STEADY; 
+    }
+
+    // Length of the window in ms.
+    uint32_t windowMs() const { return _period * B; }
+
+  private:
+
+    // One period of the window.
+    struct stormBucket {
+      uint16_t strikes; 
+      uint16_t ranged;       // Strikes with a distance.
+      uint32_t distanceSum;  // Of the strikes with a distance.
+      uint8_t  closest;      // STORM_OUT_OF_RANGE when none in range.
+      uint8_t  energy[STORM_ENERGY_BINS]; 
+    };
+
+    // Removes a period from the running totals and empties it.
+    void dropBucket(uint8_t _index)
+    {
+      stormBucket &_bucket = _buckets[_index]; 
+      _strikeTotal -= _bucket.strikes; 
+      for(uint8_t k = 0; k < STORM_ENERGY_BINS; k++)
+        _energyTotal[k] -= _bucket.energy[k]; 
+      memset(&_bucket, 0, sizeof(_bucket)); 
+      _bucket.closest = STORM_OUT_OF_RANGE; 
+    }
+
+    // Position of the highest set bit less four, 0 under 32.
+    static uint8_t energyBin(uint32_t _energy)
+    {
+      if(_energy < 32)
+        return 0; 
+      uint8_t _log2 = 5; 
+      _energy >>= 5; 
+      while( (_energy > 1) && (_log2 < 19) ){
+        _energy >>= 1; 
+        _log2++; 
+      }
+      return _log2 - 4; 
+    }
+
+    stormBucket _buckets[B]; 
+    uint16_t _energyTotal[STORM_ENERGY_BINS]; 
+    uint32_t _strikeTotal; 
+    uint32_t _period; 
+    uint32_t _periodStart = 0; // millis() when the newest period began.
+    uint8_t _newest; 
+    bool _started; 
+
+};
+#endif
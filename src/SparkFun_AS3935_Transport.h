@@ -0,0 +1,290 @@
+#ifndef _SPARKFUN_AS3935_TRANSPORT_H_
+#define _SPARKFUN_AS3935_TRANSPORT_H_
+
+#include <Wire.h>
+#include <SPI.h>
+#include <Arduino.h>
+#include "SparkFun_AS3935_Core.h"
+
+// Timing and interrupt control shared by the Arduino transports. 
+class AS3935ArduinoPlatform
+{
+  public:
+    uint32_t nowMicros() { return micros(); }
+    uint32_t nowMillis() { return millis(); }
+    void delayMs(uint16_t _ms) { delay(_ms); }
+    void disableIrq() { noInterrupts(); }
+    void enableIrq() { interrupts(); }
+    // notifyIrq() runs in an ISR, where interrupts are off already and must
+    // not be turned back on. 
+    void lockFromIrq() { }
+    void unlockFromIrq() { }
+
+    // Wire and SPI have no portable non-blocking API, so startRead() and
+    // startWrite() run the transfer to the end and this reports how it went.
+    // Only the Wire timeout, see AS3935I2CTransport, cuts a stuck one short. 
+    transferStatus pollTransfer() { return _transferStatus; }
+    void abortTransfer() { _transferStatus = TRANSFER_IDLE; }
+
+  protected:
+    transferStatus _transferStatus = TRANSFER_IDLE; 
+};
+
+// I-squared-C transport. Wire.begin() should be called in the sketch to avoid
+// multiple begins with other libraries. Where the core has setWireTimeout()
+// (WIRE_HAS_TIMEOUT), begin() sets it, so that a device holding SCL or SDA
+// low can not hang a transfer: Wire resets itself and the transfer ends
+// with TRANSFER_TIMEOUT. This applies to every user of the port. Other cores
+// fall back on their own Wire timeout, if any. 
+class AS3935I2CTransport : public AS3935ArduinoPlatform
+{
+  public:
+    AS3935I2CTransport(i2cAddress _deviceAddress = AS3935_DEFAULT_ADDRESS, TwoWire &_wirePort = Wire) :
+      _i2cPort(&_wirePort), _address(_deviceAddress) { }
+
+    void begin()
+    {
+#if defined(WIRE_HAS_TIMEOUT)
+      _i2cPort->setWireTimeout(_timeoutUs, true); // Reset Wire when it times out. 
+#endif
+    }
+
+    // How long Wire may wait on the bus, applied by the next begin(). 
+    void setTransferTimeout(uint32_t _micros) { _timeoutUs = _micros; }
+
+    // A return of 0 from endTransmission() indicates success, else an error
+    // occurred. 
+    bool probe()
+    {
+      _i2cPort->beginTransmission(_address);
+      return (_i2cPort->endTransmission() == 0); 
+    }
+
+    uint8_t readRegisters(uint8_t _reg, uint8_t *_buf, uint8_t _len)
+    {
+      uint8_t _count = 0; 
+      _i2cPort->beginTransmission(_address); 
+      _i2cPort->write(_reg); // Moves pointer to the first register.
+      if(_i2cPort->endTransmission(false) != 0) // Restart so that bus is not released.
+        return 0; // Not acknowledged, nothing to read. 
+      // Read all of the registers at once, keeping the bus inside a session. 
+      _i2cPort->requestFrom((uint8_t)_address, _len, (uint8_t)(_sessionDepth == 0)); 
+      _held = (_sessionDepth > 0); 
+      while( (_count < _len) && _i2cPort->available() )
+        _buf[_count++] = _i2cPort->read();
+      return _count; 
+    }
+
+    bool writeRegisters(uint8_t _reg, const uint8_t *_buf, uint8_t _len)
+    {
+      _i2cPort->beginTransmission(_address); // Start communication.
+      _i2cPort->write(_reg); // at register....
+      for(uint8_t i = 0; i < _len; i++)
+        _i2cPort->write(_buf[i]); // Write each following register...
+      _held = (_sessionDepth > 0); 
+      return (_i2cPort->endTransmission(!_held) == 0); // End communcation.
+    }
+
+    bool startRead(uint8_t _reg, uint8_t *_buf, uint8_t _len)
+    {
+      clearTimeout(); 
+      _transferStatus = transferResult(readRegisters(_reg, _buf, _len) == _len); 
+      return true; 
+    }
+
+    bool startWrite(uint8_t _reg, const uint8_t *_buf, uint8_t _len)
+    {
+      clearTimeout(); 
+      _transferStatus = transferResult(writeRegisters(_reg, _buf, _len)); 
+      return true; 
+    }
+
+    // Inside a session every transfer ends without a STOP, so the next one
+    // starts with a repeated START and no other master can take the bus in
+    // between. The STOP is sent when the outermost session ends. 
+    void beginSession() { _sessionDepth++; }
+    void endSession()
+    {
+      if( (_sessionDepth == 0) || (--_sessionDepth > 0) )
+        return; 
+      if(_held){
+        _i2cPort->beginTransmission(_address); 
+        _i2cPort->endTransmission(); // Releases the bus. 
+        _held = false; 
+      }
+    }
+
+  private:
+    // Wire flags a transfer it gave up on, until the flag is cleared. 
+    void clearTimeout()
+    {
+#if defined(WIRE_HAS_TIMEOUT)
+      _i2cPort->clearWireTimeoutFlag(); 
+#endif
+    }
+
+    transferStatus transferResult(bool _ok)
+    {
+      if(_ok)
+        return TRANSFER_DONE; 
+#if defined(WIRE_HAS_TIMEOUT)
+      if(_i2cPort->getWireTimeoutFlag())
+        return TRANSFER_TIMEOUT; 
+#endif
+      return TRANSFER_FAILED; 
+    }
+
+    TwoWire *_i2cPort; 
+    i2cAddress _address; 
+    uint32_t _timeoutUs = TRANSFER_TIMEOUT_US; 
+    uint8_t _sessionDepth = 0; 
+    bool _held = false; // The last transfer ended without a STOP. 
+};
+
+// SPI transport. Make sure the port speed is not 500kHz or it will cause
+// feedback with the antenna. 
+class AS3935SPITransport : public AS3935ArduinoPlatform
+{
+  public:
+    AS3935SPITransport(uint8_t _csPin = 0, uint32_t _portSpeed = 2000000, SPIClass &_port = SPI) :
+      _spiPort(&_port), _spiPortSpeed(_portSpeed), _cs(_csPin) { }
+
+    void begin()
+    {
+      pinMode(_cs, OUTPUT); 
+      digitalWrite(_cs, HIGH);// Deselect the Lightning Detector. 
+      _spiPort->begin(); // Set up the SPI pins. 
+    }
+
+    // SPI has no acknowledge, so there is nothing to check. 
+    bool probe() { return true; }
+
+    uint8_t readRegisters(uint8_t _reg, uint8_t *_buf, uint8_t _len)
+    {
+      if(_sessionDepth == 0)
+        _spiPort->beginTransaction(SPISettings(_spiPortSpeed, MSBFIRST, SPI_MODE1)); 
+      digitalWrite(_cs, LOW); // Start communication.
+      _spiPort->transfer(_reg | SPI_READ_M);  // Register OR'ed with SPI read command. 
+      for(uint8_t i = 0; i < _len; i++)
+        _buf[i] = _spiPort->transfer(0); // Clock out each following register. 
+      // According to datsheet, the chip select must be written HIGH, LOW, HIGH
+      // to correctly end the READ command. 
+      digitalWrite(_cs, HIGH); 
+      digitalWrite(_cs, LOW); 
+      digitalWrite(_cs, HIGH); 
+      if(_sessionDepth == 0)
+        _spiPort->endTransaction();
+      return _len; 
+    }
+
+    bool writeRegisters(uint8_t _reg, const uint8_t *_buf, uint8_t _len)
+    {
+      if(_sessionDepth == 0)
+        _spiPort->beginTransaction(SPISettings(_spiPortSpeed, MSBFIRST, SPI_MODE1)); 
+      digitalWrite(_cs, LOW); // Start communication
+      _spiPort->transfer(_reg); // Start write command at given register
+      for(uint8_t i = 0; i < _len; i++)
+        _spiPort->transfer(_buf[i]); // Write each following register
+      digitalWrite(_cs, HIGH); // End communcation
+      if(_sessionDepth == 0)
+        _spiPort->endTransaction();
+      return true; 
+    }
+
+    bool startRead(uint8_t _reg, uint8_t *_buf, uint8_t _len)
+    {
+      _transferStatus = (readRegisters(_reg, _buf, _len) == _len) ? TRANSFER_DONE : TRANSFER_FAILED; 
+      return true; 
+    }
+
+    bool startWrite(uint8_t _reg, const uint8_t *_buf, uint8_t _len)
+    {
+      _transferStatus = writeRegisters(_reg, _buf, _len) ? TRANSFER_DONE : TRANSFER_FAILED; 
+      return true; 
+    }
+
+    // One beginTransaction() for the whole session instead of one per
+    // transfer. Chip select still frames every command, as the IC requires. 
+    void beginSession()
+    {
+      if(_sessionDepth++ == 0)
+        _spiPort->beginTransaction(SPISettings(_spiPortSpeed, MSBFIRST, SPI_MODE1)); 
+    }
+
+    void endSession()
+    {
+      if( (_sessionDepth > 0) && (--_sessionDepth == 0) )
+        _spiPort->endTransaction(); 
+    }
+
+  private:
+    SPIClass *_spiPort; 
+    uint32_t _spiPortSpeed; 
+    uint8_t _cs; // Chip select pin
+    uint8_t _sessionDepth = 0; 
+};
+
+// Picks I2C or SPI at run time, for SparkFun_AS3935 where the bus is only
+// known once begin() or beginSPI() is called. 
+class AS3935ArduinoTransport : public AS3935ArduinoPlatform
+{
+  public:
+    AS3935ArduinoTransport(i2cAddress _deviceAddress = AS3935_DEFAULT_ADDRESS) :
+      _i2c(_deviceAddress), _useSPI(false) { }
+
+    void useI2C(TwoWire &_wirePort, i2cAddress _deviceAddress)
+    {
+      _i2c = AS3935I2CTransport(_deviceAddress, _wirePort); 
+      _i2c.setTransferTimeout(_timeoutUs); 
+      _useSPI = false; 
+    }
+
+    void useSPI(uint8_t _csPin, uint32_t _portSpeed, SPIClass &_port)
+    {
+      _spi = AS3935SPITransport(_csPin, _portSpeed, _port); 
+      _useSPI = true; 
+    }
+
+    void begin() { if(_useSPI) _spi.begin(); else _i2c.begin(); }
+    bool probe() { return _useSPI ? _spi.probe() : _i2c.probe(); }
+
+    // Kept for I2C ports picked later, applied by the next begin(). 
+    void setTransferTimeout(uint32_t _micros)
+    {
+      _timeoutUs = _micros; 
+      _i2c.setTransferTimeout(_micros); 
+    }
+
+    uint8_t readRegisters(uint8_t _reg, uint8_t *_buf, uint8_t _len)
+    {
+      return _useSPI ? _spi.readRegisters(_reg, _buf, _len) : _i2c.readRegisters(_reg, _buf, _len); 
+    }
+
+    bool writeRegisters(uint8_t _reg, const uint8_t *_buf, uint8_t _len)
+    {
+      return _useSPI ? _spi.writeRegisters(_reg, _buf, _len) : _i2c.writeRegisters(_reg, _buf, _len); 
+    }
+
+    void beginSession() { if(_useSPI) _spi.beginSession(); else _i2c.beginSession(); }
+    void endSession() { if(_useSPI) _spi.endSession(); else _i2c.endSession(); }
+
+    bool startRead(uint8_t _reg, uint8_t *_buf, uint8_t _len)
+    {
+      return _useSPI ? _spi.startRead(_reg, _buf, _len) : _i2c.startRead(_reg, _buf, _len); 
+    }
+
+    bool startWrite(uint8_t _reg, const uint8_t *_buf, uint8_t _len)
+    {
+      return _useSPI ? _spi.startWrite(_reg, _buf, _len) : _i2c.startWrite(_reg, _buf, _len); 
+    }
+
+    transferStatus pollTransfer() { return _useSPI ? _spi.pollTransfer() : _i2c.pollTransfer(); }
+    void abortTransfer() { if(_useSPI) _spi.abortTransfer(); else _i2c.abortTransfer(); }
+
+  private:
+    AS3935I2CTransport _i2c; 
+    AS3935SPITransport _spi; 
+    uint32_t _timeoutUs = TRANSFER_TIMEOUT_US; 
+    bool _useSPI; 
+};
+#endif